@@ -13,6 +13,7 @@ extern "C"
 #include "buzzer.hpp"
 #include "control.hpp"
 #include "fan.hpp"
+#include "adcservice.hpp"
 #include "auto.hpp"
 #include "chairAdjust.hpp"
 #include "display.hpp"
@@ -101,16 +102,52 @@ motorctl_config_t configMotorControlLeft = {
     .loggingEnabled = true,
     .msFadeAccel = 1800, // acceleration of the motor (ms it takes from 0% to 100%)
     .msFadeDecel = 1600, // deceleration of the motor (ms it takes from 100% to 0%)
-    .currentLimitEnabled = false,
+    .msJerkAccel = 300, // time to reach full acceleration (S-curve, 0 = linear ramp)
+    .msJerkDecel = 200, // time to reach full deceleration
+    .currentLimitEnabled = true, // enforce thermal current limit (I²t)
     .tractionControlSystemEnabled = false,
     .currentSensor_adc = ADC1_CHANNEL_4, // GPIO32
     .currentSensor_ratedCurrent = 50,
-    .currentMax = 30,
+    .currentMax = 30, // continuous current
+    .currentPeak = 50, // short bursts (e.g. hill start), reduced to currentMax when thermal budget is used up
+    .thermalTauMotorS = 60, // heating time constant motor (~20s at peak current from cold)
+    .thermalTauDriverS = 10, // heating time constant driver (~3s at peak current from cold)
+    .thermalTaperStartLoad = 0.8, // start reducing allowed current at 80% thermal load
     .currentInverted = true,
     .currentSnapToZeroThreshold = 0.15,
-    .deadTimeMs = 0, // minimum time motor is off between direction change
+    .deadTimeMs = 500, // minimum time motor is off between direction change (only used when speed is unknown, e.g. sensor failed)
+    .deadTimeMaxSpeedKmh = 0.5, // reverse as soon as wheel is that slow
     .brakePauseBeforeResume = 1500,
     .brakeDecel = 400,
+    .msJerkBrake = 100, // time to reach full brake deceleration
+    // speed control (SPEED mode)
+    .speedControlMaxKmh = 10,  // target speed at 100% input
+    .speedControlMaxDuty = 100, // max duty the speed controller outputs
+    .speedControlKp = 10,      // %duty per km/h (default gains, can be overridden in nvs)
+    .speedControlKi = 20,      // %duty per km/h*s
+    .speedControlKd = 0,
+    // current control (CURRENT mode)
+    .currentControlKp = 2,        // %duty per A
+    .currentControlKi = 40,       // %duty per A*s
+    .currentControlPeriodMs = 10, // min time between current controller updates
+    // cascaded control (CASCADED mode: speed loop => current loop)
+    .cascadeSpeedKp = 4,          // target A per km/h
+    .cascadeSpeedKi = 6,          // target A per km/h*s
+    .cascadeSpeedPeriodMs = 50,   // outer speed loop period (inner loop runs with currentControlPeriodMs)
+    // motor model
+    .speedAtFullDutyKmh = 16,     // speed at 100% duty (default until duty-speed map is learned)
+    .dsMapVoltageMin = 21,        // battery voltage range the learned duty-speed map is binned over (7s: 3.0V-4.2V)
+    .dsMapVoltageMax = 29.4,
+    // traction control (model based, works in all control modes)
+    .tcsAccelPerAmpere = 0.2,      // km/h per s per A with grip
+    .tcsMaxAccelExcessKmhs = 4,    // slip when accelerating that much faster than the current predicts
+    .tcsMaxSpeedExcessKmh = 1.5,   // slip when that much faster than other wheel (beyond duty difference)
+    .tcsRestoreRate = 50,          // % per s duty limit is raised once grip returned
+    // anti-lock brake (modulates BRAKE strength and brake deceleration when wheel is locking)
+    .absEnabled = false,
+    .absMaxDecelKmhs = 8,          // max deceleration of the chassis, wheel decelerating faster is locking
+    .absReleaseFactor = 0.3,       // brake strength while locking
+    .absReapplyRate = 2,           // brake strength reapplied from 0 to full within 0.5s
 };
 
 //--- configure right motor (contol) ---
@@ -119,18 +156,61 @@ motorctl_config_t configMotorControlRight = {
     .loggingEnabled = false,
     .msFadeAccel = 1800, // acceleration of the motor (ms it takes from 0% to 100%)
     .msFadeDecel = 1600, // deceleration of the motor (ms it takes from 100% to 0%)
-    .currentLimitEnabled = false,
+    .msJerkAccel = 300, // time to reach full acceleration (S-curve, 0 = linear ramp)
+    .msJerkDecel = 200, // time to reach full deceleration
+    .currentLimitEnabled = true, // enforce thermal current limit (I²t)
     .tractionControlSystemEnabled = false,
     .currentSensor_adc = ADC1_CHANNEL_5, // GPIO33
     .currentSensor_ratedCurrent = 50,
-    .currentMax = 30,
+    .currentMax = 30, // continuous current
+    .currentPeak = 50, // short bursts (e.g. hill start), reduced to currentMax when thermal budget is used up
+    .thermalTauMotorS = 60, // heating time constant motor (~20s at peak current from cold)
+    .thermalTauDriverS = 10, // heating time constant driver (~3s at peak current from cold)
+    .thermalTaperStartLoad = 0.8, // start reducing allowed current at 80% thermal load
     .currentInverted = false,
     .currentSnapToZeroThreshold = 0.25,
-    .deadTimeMs = 0, // minimum time motor is off between direction change
+    .deadTimeMs = 500, // minimum time motor is off between direction change (only used when speed is unknown, e.g. sensor failed)
+    .deadTimeMaxSpeedKmh = 0.5, // reverse as soon as wheel is that slow
     .brakePauseBeforeResume = 1500,
     .brakeDecel = 400,
+    .msJerkBrake = 100, // time to reach full brake deceleration
+    // speed control (SPEED mode)
+    .speedControlMaxKmh = 10,  // target speed at 100% input
+    .speedControlMaxDuty = 100, // max duty the speed controller outputs
+    .speedControlKp = 10,      // %duty per km/h (default gains, can be overridden in nvs)
+    .speedControlKi = 20,      // %duty per km/h*s
+    .speedControlKd = 0,
+    // current control (CURRENT mode)
+    .currentControlKp = 2,        // %duty per A
+    .currentControlKi = 40,       // %duty per A*s
+    .currentControlPeriodMs = 10, // min time between current controller updates
+    // cascaded control (CASCADED mode: speed loop => current loop)
+    .cascadeSpeedKp = 4,          // target A per km/h
+    .cascadeSpeedKi = 6,          // target A per km/h*s
+    .cascadeSpeedPeriodMs = 50,   // outer speed loop period (inner loop runs with currentControlPeriodMs)
+    // motor model
+    .speedAtFullDutyKmh = 16,     // speed at 100% duty (default until duty-speed map is learned)
+    .dsMapVoltageMin = 21,        // battery voltage range the learned duty-speed map is binned over (7s: 3.0V-4.2V)
+    .dsMapVoltageMax = 29.4,
+    // traction control (model based, works in all control modes)
+    .tcsAccelPerAmpere = 0.2,      // km/h per s per A with grip
+    .tcsMaxAccelExcessKmhs = 4,    // slip when accelerating that much faster than the current predicts
+    .tcsMaxSpeedExcessKmh = 1.5,   // slip when that much faster than other wheel (beyond duty difference)
+    .tcsRestoreRate = 50,          // % per s duty limit is raised once grip returned
+    // anti-lock brake (modulates BRAKE strength and brake deceleration when wheel is locking)
+    .absEnabled = false,
+    .absMaxDecelKmhs = 8,          // max deceleration of the chassis, wheel decelerating faster is locking
+    .absReleaseFactor = 0.3,       // brake strength while locking
+    .absReapplyRate = 2,           // brake strength reapplied from 0 to full within 0.5s
 };
 
+//--- control loop rate ---
+// period the motorctl task runs the handle function with (fixed rate, woken by esp_timer)
+// note: the blocking current-sensor read currently takes ~1.5ms per cycle
+const uint32_t motorctlControlPeriodUs = 10000; // 100Hz
+// max total power of both motors (shared, prevents battery brownout), 0 = disabled
+const float motorctlPowerBudgetW = 1500;
+
 //------------------------------
 //------- control config -------
 //------------------------------
@@ -176,12 +256,34 @@ joystick_config_t configJoystick = {
     .x_inverted = false,
     .y_inverted = true};
 
+
+
+//---------------------------------------
+//------- ADC service configuration -----
+//---------------------------------------
+// all ADC1 channels are sampled continuously in background by the adc service (oneshot reads are not possible while it is running)
+// => every used ADC1 channel has to be registered here
+// with 20kHz total and weights 4+4+1+1+1 (11 conversions per cycle):
+// - current sensors: 7.3kHz, 32x oversampling => new value every 4.4ms (faster than motorctl cycle)
+// - joystick: 1.8kHz, 16x oversampling => new value every 9ms
+// - battery: 1.8kHz, 64x oversampling + low pass => new value every 35ms
+const adcChannel_config_t adcServiceChannels[] = {
+    // channel,     name,         weight, oversampling, filterAlpha
+    {ADC1_CHANNEL_4, "currentLeft",  4, 32, 1},    // GPIO32
+    {ADC1_CHANNEL_5, "currentRight", 4, 32, 1},    // GPIO33
+    {ADC1_CHANNEL_0, "joystickX",    1, 16, 1},    // GPIO36
+    {ADC1_CHANNEL_3, "joystickY",    1, 16, 1},    // GPIO39
+    {ADC1_CHANNEL_6, "battery",      1, 64, 0.1},  // GPIO34
+};
+const uint32_t adcServiceSampleFreqHz = 20000; // total conversion rate shared by all channels (by weight)
+
 //----------------------------
 //--- configure fan contol ---
 //----------------------------
 fan_config_t configFans = {
     .gpio_fan = GPIO_NUM_13,
     .dutyThreshold = 50,
+    .thermalLoadThreshold = 0.5, // also turn on when half of thermal budget of a motor/driver is used
     .minOnMs = 3500, // time motor duty has to be above the threshold for fans to turn on
     .minOffMs = 5000, // min time fans have to be off to be able to turn on again
     .turnOffDelayMs = 3000, // time fans continue to be on after duty is below threshold 
@@ -194,6 +296,8 @@ fan_config_t configFans = {
 //--------------------------------------------
 speedSensor_config_t speedLeft_config{
     .gpioPin = GPIO_NUM_5,
+    .backend = SPEED_BACKEND_MCPWM_CAPTURE, // edges timestamped by hardware (alternative: SPEED_BACKEND_GPIO_ISR)
+    .captureChannel = MCPWM_SELECT_CAP0,
     .degreePerGroup = 360 / 16,
 	.minPulseDurationUs = 3000, //smallest possible pulse duration (< time from start small-pulse to start long-pulse at full speed). Set to 0 to disable this noise detection
     //measured wihth scope while tires in the air:
@@ -206,6 +310,8 @@ speedSensor_config_t speedLeft_config{
 
 speedSensor_config_t speedRight_config{
     .gpioPin = GPIO_NUM_14,
+    .backend = SPEED_BACKEND_MCPWM_CAPTURE, // edges timestamped by hardware (alternative: SPEED_BACKEND_GPIO_ISR)
+    .captureChannel = MCPWM_SELECT_CAP1,
     .degreePerGroup = 360 / 12,
 	.minPulseDurationUs = 4000, //smallest possible pulse duration (< time from start small-pulse to start long-pulse at full speed). Set to 0 to disable this noise detection
     .tireCircumferenceMeter = 0.81,
@@ -213,6 +319,9 @@ speedSensor_config_t speedRight_config{
     .logName = "speedRight"
 };
 
+// distance between the contact points of both tires (heading of chassis odometry)
+float chassisTrackWidthMeter = 0.6;
+
 
 
 //-------------------------
@@ -5,6 +5,8 @@ extern "C"{
 }
 
 #include "menu.hpp"
+#include "adcservice.hpp"
+#include "adccalibration.hpp"
 
 
 
@@ -34,7 +36,10 @@ bool notificationIsActive = false;
 //--------------------------
 //TODO duplicate code: getVoltage also defined in currentsensor.cpp -> outsource this
 //local function to get average voltage from adc
+//uses latest value published by adc service when running
 int readAdc(adc1_channel_t adc, uint32_t samples){
+	int rawService = adcService_getRaw(adc);
+	if (rawService >= 0) return rawService;
 	//measure voltage
 	uint32_t measure = 0;
 	for (int j=0; j<samples; j++){
@@ -63,7 +68,7 @@ static displayStatusPage_t selectedStatusPage = STATUS_SCREEN_OVERVIEW;
 //==== display_init ====
 //======================
 void display_init(display_config_t config){
-	adc1_config_channel_atten(ADC1_CHANNEL_6, ADC_ATTEN_DB_11); //max voltage
+	if (!adcService_isRunning()) adc1_config_channel_atten(ADC1_CHANNEL_6, ADC_ATTEN_DB_11); //max voltage (configured by adc service otherwise)
 	ESP_LOGI(TAG, "Initializing Display with config: sda=%d, sdl=%d, reset=%d,  offset=%d, flip=%d, size: %dx%d", 
 	config.gpio_sda, config.gpio_scl, config.gpio_reset, config.offsetX, config.flip, config.width, config.height);
 
@@ -210,7 +215,8 @@ float getBatteryVoltage(){
 
 	//convert adc to voltage using lookup table
 	float battVoltage = scaleUsingLookupTable(batteryAdcValues, batteryVoltages, countAdc, adcRead);
-	ESP_LOGD(TAG, "batteryVoltage - adcRaw=%d => voltage=%.3f, scaled using lookuptable with %d elements", adcRead, battVoltage, countAdc);
+	ESP_LOGD(TAG, "batteryVoltage - adcRaw=%d (pin=%.3fV calibrated) => voltage=%.3f, scaled using lookuptable with %d elements",
+			 adcRead, adcCal_rawToVoltage(ADC_BATT_VOLTAGE, adcRead), battVoltage, countAdc);
 	return battVoltage;
 }
 
@@ -339,7 +345,7 @@ void showStatusScreenJoystick(display_task_parameters_t * objects)
 //#############################
 //##### showScreen motors #####
 //#############################
-// shows speed of each motor in km/h large in two lines and RPM in last line
+// shows power of each motor large in two lines, duty and thermal load (I²t model) in last lines
 #define STATUS_SCREEN_MOTORS_UPDATE_INTERVAL 150
 void showStatusScreenMotors(display_task_parameters_t *objects)
 {
@@ -350,13 +356,31 @@ void showStatusScreenMotors(display_task_parameters_t *objects)
 		displayTextLineCentered(&dev, 6, false, false, "%+03.0f%% | %+03.0f%% DTY",
 						objects->motorLeft->getStatus().duty,
 						objects->motorRight->getStatus().duty);
-		displayTextLineCentered(&dev, 7, false, false, "%+04.0f | %+04.0f RPM",
-								objects->speedLeft->getRpm(),
-								objects->speedRight->getRpm());
+		displayTextLineCentered(&dev, 7, false, false, "%03.0f%% | %03.0f%% HEAT",
+								objects->motorLeft->getThermalLoad() * 100,
+								objects->motorRight->getThermalLoad() * 100);
 		vTaskDelay(STATUS_SCREEN_MOTORS_UPDATE_INTERVAL / portTICK_PERIOD_MS);
 }
 
 
+//###############################
+//#### showScreen Odometry #######
+//###############################
+// shows trip odometer large, total odometer and distance / heading change of the chassis since boot
+#define STATUS_SCREEN_ODOMETRY_UPDATE_INTERVAL 500
+void showStatusScreenOdometry(display_task_parameters_t *objects)
+{
+	displayTextLine(&dev, 0, false, false, "Trip:");
+	displayTextLine(&dev, 1, true, false, "%.2fkm ",
+					(objects->speedLeft->getOdometerTripMeter() + objects->speedRight->getOdometerTripMeter()) / 2 / 1000);
+	displayTextLine(&dev, 4, false, false, "Total: %.1fkm ",
+					(objects->speedLeft->getOdometerTotalMeter() + objects->speedRight->getOdometerTotalMeter()) / 2 / 1000);
+	displayTextLine(&dev, 6, false, false, "dist: %+.1fm     ", objects->odometry->getDistanceMeter());
+	displayTextLine(&dev, 7, false, false, "heading: %+.0fdeg   ", objects->odometry->getHeadingChangeDeg());
+	vTaskDelay(STATUS_SCREEN_ODOMETRY_UPDATE_INTERVAL / portTICK_PERIOD_MS);
+}
+
+
 // ################################
 // #### showScreen Screensaver ####
 // ################################
@@ -543,6 +567,9 @@ void handleStatusScreen(display_task_parameters_t *objects)
 	case STATUS_SCREEN_MOTORS:
 		showStatusScreenMotors(objects);
 		break;
+	case STATUS_SCREEN_ODOMETRY:
+		showStatusScreenOdometry(objects);
+		break;
 	case STATUS_SCREEN_SCREENSAVER:
 		showStatusScreenScreensaver(objects);
 		break;
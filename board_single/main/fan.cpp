@@ -58,10 +58,12 @@ void controlledFan::handle(){
 	motor1Status = motor1->getStatus();
 	motor2Status = motor2->getStatus();
 
-	//--- handle duty threshold ---
+	//--- handle duty and thermal load threshold ---
 	//update timestamp if any threshold exceeded
+	float thermalLoad = fmaxf(motor1->getThermalLoad(), motor2->getThermalLoad());
 	if (motor1Status.duty > config.dutyThreshold
-			|| motor2Status.duty > config.dutyThreshold){ //TODO add temperature threshold
+			|| motor2Status.duty > config.dutyThreshold
+			|| thermalLoad > config.thermalLoadThreshold){
 		if (!needsCooling){
 			timestamp_needsCoolingSet = esp_log_timestamp();
 			needsCooling = true;
@@ -97,7 +99,7 @@ void controlledFan::handle(){
 	//TODO Add statemachine for more specific control? Exponential average?
 	//TODO idea: try other aproach? increment a variable with certain weights e.g. integrate over duty, then turn fans on and decrement the variable again
 	
-	ESP_LOGD(TAG, "fanState=%d, duty1=%f, duty2=%f, needsCooling=%d", fanRunning, motor1Status.duty, motor2Status.duty, needsCooling);
+	ESP_LOGD(TAG, "fanState=%d, duty1=%f, duty2=%f, thermalLoad=%.2f, needsCooling=%d", fanRunning, motor1Status.duty, motor2Status.duty, thermalLoad, needsCooling);
 }
 
 
@@ -13,6 +13,7 @@ extern "C"
 typedef struct fan_config_t {
     gpio_num_t gpio_fan;
     float dutyThreshold;
+    float thermalLoadThreshold; //also cool when thermal load of a motor (0-1, see thermalmodel.hpp) exceeds that
 	uint32_t minOnMs;
 	uint32_t minOffMs;
 	uint32_t turnOffDelayMs;
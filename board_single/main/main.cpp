@@ -24,7 +24,9 @@ extern "C"
 #include "motordrivers.hpp"
 #include "http.hpp"
 #include "speedsensor.hpp"
+#include "odometry.hpp"
 #include "motorctl.hpp"
+#include "adcservice.hpp"
 
 //folder single_board
 #include "control.hpp" 
@@ -63,6 +65,7 @@ httpJoystick *httpJoystickMain;
 
 speedSensor *speedLeft;
 speedSensor *speedRight;
+chassisOdometry *odometry;
 
 cControlledRest *legRest;
 cControlledRest *backRest;
@@ -142,13 +145,17 @@ void createObjects()
 
     // create speedsensor instances
     // with configurations from config.cpp
-    speedLeft = new speedSensor(speedLeft_config);
-    speedRight = new speedSensor(speedRight_config);
+    // nvs is used to persist the odometers
+    speedLeft = new speedSensor(speedLeft_config, &nvsHandle);
+    speedRight = new speedSensor(speedRight_config, &nvsHandle);
+
+    // create chassis odometry (distance and heading from both speed sensors)
+    odometry = new chassisOdometry(speedLeft, speedRight, chassisTrackWidthMeter);
 
 	// create controlled motor instances (motorctl.hpp)
     // with configurations from config.cpp
-    motorLeft = new controlledMotor(setLeftFunc, configMotorControlLeft, &nvsHandle, speedLeft, &motorRight); //note: ptr to ptr of controlledMotor since it isnt defined yet
-    motorRight = new controlledMotor(setRightFunc, configMotorControlRight, &nvsHandle, speedRight, &motorLeft);
+    motorLeft = new controlledMotor(setLeftFunc, configMotorControlLeft, &nvsHandle, speedLeft);
+    motorRight = new controlledMotor(setRightFunc, configMotorControlRight, &nvsHandle, speedRight);
 
     // create joystick instance (joystick.hpp)
     joystick = new evaluatedJoystick(configJoystick, &nvsHandle);
@@ -219,6 +226,11 @@ extern "C" void app_main(void) {
 	if (err != ESP_OK)
 		ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
 
+	//--- start adc service ---
+	// note: has to be started before objects using the adc are created (current sensor calibration)
+	ESP_LOGW(TAG, "starting ADC service...");
+	adcService_init(adcServiceChannels, sizeof(adcServiceChannels) / sizeof(adcServiceChannels[0]), adcServiceSampleFreqHz);
+
 	printf("\n");
 
 
@@ -243,10 +255,19 @@ extern "C" void app_main(void) {
 	//----------------------------------------------
 	//--- create task for controlling the motors ---
 	//----------------------------------------------
-	//task for each motor that handles to following:
-	//receives commands from control via queue, handle ramp and current, apply new duty by passing it to method of motordriver (ptr)
-	xTaskCreate(&task_motorctl, "task_ctl-left-motor", 2*4096, motorLeft, 6, NULL);
-	xTaskCreate(&task_motorctl, "task_ctl-right-motor", 2*4096, motorRight, 6, NULL);
+	//one task for both motors that handles to following (in lock-step):
+	//receives commands from control via queue, handle ramp and current, apply new duty of both motors by passing it to method of motordriver (ptr)
+	//note: handle is run at a fixed rate with period from config.cpp, power budget is divided between both motors
+	//battery voltage (duty-speed map, power budget) is read by the task itself using the lookup table in display.cpp
+	motorctl_task_parameters_t motorctl_param = {motorLeft, motorRight, motorctlControlPeriodUs, motorctlPowerBudgetW, getBatteryVoltage};
+	xTaskCreate(&task_motorctl, "task_motorctl", 2*4096, &motorctl_param, 6, NULL);
+
+	//---------------------------------
+	//--- create task for telemetry ---
+	//---------------------------------
+	//low priority task that drains the per-cycle telemetry records of both motors and outputs them
+	telemetry_task_parameters_t telemetry_param = {motorLeft->getTelemetryBuffer(), motorRight->getTelemetryBuffer(), 200};
+	xTaskCreate(&task_telemetry, "task_telemetry", 3*1024, &telemetry_param, 1, NULL);
 
 	//------------------------------
 	//--- create task for buzzer ---
@@ -280,7 +301,7 @@ extern "C" void app_main(void) {
 	//----- create task for display -----
 	//-----------------------------------
 	//task that handles the display (show stats, handle menu in 'MENU_SETTINGS' and 'MENU_MODE_SELECT' mode)
-	display_task_parameters_t display_param = {display_config, control, joystick, encoderQueue, motorLeft, motorRight, speedLeft, speedRight, buzzer, &nvsHandle};
+	display_task_parameters_t display_param = {display_config, control, joystick, encoderQueue, motorLeft, motorRight, speedLeft, speedRight, odometry, buzzer, &nvsHandle};
 	xTaskCreate(&display_task, "display_task", 3*2048, &display_param, 3, NULL);
 	
 	//-------------------------------------
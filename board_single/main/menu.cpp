@@ -423,6 +423,10 @@ void item_motorControlMode_action(display_task_parameters_t *objects, SSD1306_t
     objects->motorLeft->setControlMode(motorControlMode_t::SPEED);
     objects->motorRight->setControlMode(motorControlMode_t::SPEED);
         break;
+    case 4:
+    objects->motorLeft->setControlMode(motorControlMode_t::CASCADED);
+    objects->motorRight->setControlMode(motorControlMode_t::CASCADED);
+        break;
     }
 }
 int item_motorControlMode_value(display_task_parameters_t *objects)
@@ -434,7 +438,7 @@ menuItem_t item_motorControlMode = {
     item_motorControlMode_value,  // function get initial value or NULL(show in line 2)
     NULL,                     // function get default value or NULL(dont set value, show msg)
     1,                        // valueMin
-    3,                        // valueMax
+    4,                        // valueMax
     1,                        // valueIncrement
     "Control mode    ",       // title
     "  sel. motor    ",       // line1 (above value)
@@ -442,7 +446,7 @@ menuItem_t item_motorControlMode = {
     "1: DUTY (defaul)",            // line4 * (below value)
     "2: CURRENT",              // line5 *
     "3: SPEED",            // line6
-    "",              // line7
+    "4: CASCADED",         // line7
 };
 
 //###################################
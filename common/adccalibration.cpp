@@ -0,0 +1,63 @@
+extern "C"
+{
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_adc_cal.h"
+}
+
+#include "adccalibration.hpp"
+
+//tag for logging
+static const char * TAG = "adc-cal";
+
+#define ADC_CAL_DEFAULT_VREF_MV 1100 //used when eFuse contains no calibration data
+#define ADC_CAL_TABLE_SIZE 4096      //one entry per raw value (12 bit)
+
+
+//======================
+//===== variables ======
+//======================
+static uint16_t * tables[ADC_ATTEN_MAX] = {}; //raw -> millivolt, per attenuation
+static const uint16_t * channelTable[ADC1_CHANNEL_MAX] = {};
+
+
+
+//=================================
+//===== adcCal_registerChannel ====
+//=================================
+void adcCal_registerChannel(adc1_channel_t channel, adc_atten_t atten){
+    if (channel >= ADC1_CHANNEL_MAX || atten >= ADC_ATTEN_MAX) return;
+
+    //--- build table of this attenuation once ---
+    if (tables[atten] == NULL) {
+        uint16_t * table = (uint16_t *)malloc(ADC_CAL_TABLE_SIZE * sizeof(uint16_t));
+        if (table == NULL) {
+            ESP_LOGE(TAG, "failed to allocate correction table for atten=%d - using linear conversion", (int)atten);
+            return;
+        }
+        esp_adc_cal_characteristics_t characteristics;
+        esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, atten, ADC_WIDTH_BIT_12, ADC_CAL_DEFAULT_VREF_MV, &characteristics);
+        for (uint32_t raw = 0; raw < ADC_CAL_TABLE_SIZE; raw++)
+            table[raw] = esp_adc_cal_raw_to_voltage(raw, &characteristics);
+        tables[atten] = table;
+        ESP_LOGW(TAG, "built correction table for atten=%d using %s (raw 0 => %dmV, raw 2048 => %dmV, raw 4095 => %dmV)", (int)atten,
+                 source == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two point" : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse vref" : "default vref",
+                 table[0], table[2048], table[ADC_CAL_TABLE_SIZE - 1]);
+    }
+
+    channelTable[channel] = tables[atten];
+    ESP_LOGI(TAG, "registered channel %d with atten=%d", (int)channel, (int)atten);
+}
+
+
+
+//==============================
+//===== adcCal_rawToVoltage ====
+//==============================
+float adcCal_rawToVoltage(adc1_channel_t channel, int raw){
+    if (raw < 0) raw = 0;
+    else if (raw >= ADC_CAL_TABLE_SIZE) raw = ADC_CAL_TABLE_SIZE - 1;
+    if (channel >= ADC1_CHANNEL_MAX || channelTable[channel] == NULL)
+        return (float)raw / 4096 * 3.3;
+    return channelTable[channel][raw] / 1000.0;
+}
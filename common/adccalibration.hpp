@@ -0,0 +1,24 @@
+#pragma once
+
+extern "C"
+{
+#include <driver/adc.h>
+}
+
+#include <stdint.h>
+
+
+//=======================================
+//========== ADC calibration ============
+//=======================================
+//corrects the non-linearity and offset of the ESP32 ADC1 using the calibration data stored in eFuse (esp_adc_cal)
+//- a correction table raw -> millivolt (4096 entries) is built once per used attenuation at registration (boot)
+//- each conversion is a single table lookup afterwards (no runtime cost compared to the linear formula)
+//- without registration (or when table allocation failed) the linear mapping raw/4096*3.3 is used
+
+//assign attenuation to a channel and build correction table for that attenuation if not built yet
+//note: not thread safe, register all channels during startup before reading
+void adcCal_registerChannel(adc1_channel_t channel, adc_atten_t atten);
+
+//convert raw adc value (0-4095) of a channel to calibrated voltage
+float adcCal_rawToVoltage(adc1_channel_t channel, int raw);
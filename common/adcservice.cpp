@@ -0,0 +1,201 @@
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+}
+
+#include <atomic>
+#include "adcservice.hpp"
+#include "adccalibration.hpp"
+
+//tag for logging
+static const char * TAG = "adc-service";
+
+#define ADC_SERVICE_READ_BYTES 256 //bytes read from dma buffer at once (2 bytes per sample)
+#define ADC_SERVICE_READ_TIMEOUT_MS 100
+#define ADC_SERVICE_INIT_TIMEOUT_MS 500 //max time waiting for first value of every channel
+
+
+//======================
+//===== variables ======
+//======================
+//state of one registered channel
+//accumulator is written by task_adcService only, published values are read by any task (atomic => no lock needed)
+typedef struct {
+    bool registered;
+    adcChannel_config_t config;
+    uint32_t sum;
+    uint16_t count;
+    float filtered;
+    std::atomic<float> value;          //published raw value (filtered average)
+    std::atomic<uint32_t> updateCount; //0 until first value published
+} adcServiceChannel_t;
+static_assert(std::atomic<float>::is_always_lock_free, "published adc values have to be lock-free");
+
+static adcServiceChannel_t channelData[ADC1_CHANNEL_MAX] = {};
+static bool isRunning = false;
+static uint32_t countUnknownChannel = 0;
+
+
+
+//===========================
+//===== task_adcService =====
+//===========================
+//drain conversion results from dma buffer, oversample, filter and publish value of each channel
+static void task_adcService(void * pvParameters){
+    uint8_t buffer[ADC_SERVICE_READ_BYTES];
+    while(1){
+        uint32_t length = 0;
+        esp_err_t err = adc_digi_read_bytes(buffer, ADC_SERVICE_READ_BYTES, &length, ADC_SERVICE_READ_TIMEOUT_MS);
+        if (err == ESP_ERR_TIMEOUT) {
+            ESP_LOGE(TAG, "no conversion results within %dms", ADC_SERVICE_READ_TIMEOUT_MS);
+            continue;
+        }
+        else if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) { //INVALID_STATE: buffer overflow, data still valid
+            ESP_LOGE(TAG, "reading dma failed: %s", esp_err_to_name(err));
+            continue;
+        }
+        for (uint32_t i = 0; i + 1 < length; i += 2) {
+            adc_digi_output_data_t * result = (adc_digi_output_data_t *)&buffer[i];
+            uint32_t ch = result->type1.channel;
+            if (ch >= ADC1_CHANNEL_MAX || !channelData[ch].registered) {
+                countUnknownChannel++;
+                continue;
+            }
+            adcServiceChannel_t * c = &channelData[ch];
+            c->sum += result->type1.data;
+            if (++c->count < c->config.oversampling) continue;
+            //oversampling complete => filter and publish
+            float average = (float)c->sum / c->count;
+            c->sum = 0;
+            c->count = 0;
+            if (c->updateCount.load(std::memory_order_relaxed) == 0)
+                c->filtered = average;
+            else
+                c->filtered += c->config.filterAlpha * (average - c->filtered);
+            c->value.store(c->filtered, std::memory_order_relaxed);
+            c->updateCount.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+
+
+//==========================
+//==== adcService_init =====
+//==========================
+void adcService_init(const adcChannel_config_t * channels, uint8_t count, uint32_t sampleFreqHz){
+    if (count > ADC1_CHANNEL_MAX) count = ADC1_CHANNEL_MAX;
+    uint32_t channelMask = 0;
+    for (int i = 0; i < count; i++) {
+        adcServiceChannel_t * c = &channelData[channels[i].channel];
+        c->config = channels[i];
+        if (c->config.weight < 1) c->config.weight = 1;
+        if (c->config.oversampling < 1) c->config.oversampling = 1;
+        if (c->config.filterAlpha <= 0 || c->config.filterAlpha > 1) c->config.filterAlpha = 1;
+        c->registered = true;
+        adcCal_registerChannel(channels[i].channel, ADC_ATTEN_DB_11); //same attenuation as scan pattern
+        channelMask |= BIT(channels[i].channel);
+    }
+
+    //--- build scan pattern ---
+    //distribute conversions of each channel evenly over the cycle (round robin by remaining weight)
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {};
+    uint8_t remaining[ADC1_CHANNEL_MAX] = {};
+    uint32_t totalWeight = 0;
+    for (int i = 0; i < count; i++)
+        remaining[i] = channelData[channels[i].channel].config.weight;
+    uint32_t patternLength = 0;
+    bool added = true;
+    while (added && patternLength < SOC_ADC_PATT_LEN_MAX) {
+        added = false;
+        for (int i = 0; i < count && patternLength < SOC_ADC_PATT_LEN_MAX; i++) {
+            if (remaining[i] == 0) continue;
+            remaining[i]--;
+            pattern[patternLength].atten = ADC_ATTEN_DB_11; //max voltage
+            pattern[patternLength].channel = channels[i].channel;
+            pattern[patternLength].unit = 0; //ADC1
+            pattern[patternLength].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+            patternLength++;
+            added = true;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (remaining[i] > 0)
+            ESP_LOGE(TAG, "scan pattern full (max %d conversions) - weight of '%s' reduced by %d", SOC_ADC_PATT_LEN_MAX, channels[i].name, remaining[i]);
+        totalWeight += channelData[channels[i].channel].config.weight - remaining[i];
+    }
+
+    //--- initialize digital controller ---
+    adc_digi_init_config_t initConfig = {
+        .max_store_buf_size = 1024,
+        .conv_num_each_intr = ADC_SERVICE_READ_BYTES,
+        .adc1_chan_mask = channelMask,
+        .adc2_chan_mask = 0,
+    };
+    ESP_ERROR_CHECK(adc_digi_initialize(&initConfig));
+
+    adc_digi_configuration_t digiConfig = {
+        .conv_limit_en = ADC_CONV_LIMIT_EN,
+        .conv_limit_num = 250,
+        .pattern_num = patternLength,
+        .adc_pattern = pattern,
+        .sample_freq_hz = sampleFreqHz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    ESP_ERROR_CHECK(adc_digi_controller_configure(&digiConfig));
+    ESP_ERROR_CHECK(adc_digi_start());
+
+    //--- start task that drains dma buffer ---
+    //note: higher priority than motorctl, work per run is short
+    xTaskCreate(&task_adcService, "task_adcService", 3*1024, NULL, 7, NULL);
+    isRunning = true;
+
+    //--- log resulting schedule ---
+    ESP_LOGW(TAG, "started continuous sampling of %d ADC1 channels (mask=0x%02x, %d conversions per cycle) with %dHz:",
+             count, channelMask, patternLength, sampleFreqHz);
+    for (int i = 0; i < count; i++) {
+        const adcChannel_config_t * config = &channelData[channels[i].channel].config;
+        float sampleRate = totalWeight ? (float)sampleFreqHz * (config->weight - remaining[i]) / totalWeight : 0;
+        ESP_LOGW(TAG, "  - ch%d '%s': %.0fHz sampled, %d samples averaged => %.1fHz published, filterAlpha=%.2f",
+                 config->channel, config->name, sampleRate, config->oversampling, sampleRate / config->oversampling, config->filterAlpha);
+    }
+
+    //--- wait for first published value of every channel ---
+    for (int i = 0; i < ADC_SERVICE_INIT_TIMEOUT_MS / 10; i++) {
+        bool allPublished = true;
+        for (int j = 0; j < count; j++)
+            if (channelData[channels[j].channel].updateCount.load() == 0) allPublished = false;
+        if (allPublished) return;
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    ESP_LOGE(TAG, "not all channels published a value within %dms", ADC_SERVICE_INIT_TIMEOUT_MS);
+}
+
+
+
+//=========================
+//====== get values =======
+//=========================
+bool adcService_isRunning(){
+    return isRunning;
+}
+
+int adcService_getRaw(adc1_channel_t channel){
+    if (!isRunning || channel >= ADC1_CHANNEL_MAX || !channelData[channel].registered) return -1;
+    if (channelData[channel].updateCount.load(std::memory_order_acquire) == 0) return -1;
+    return (int)(channelData[channel].value.load(std::memory_order_relaxed) + 0.5);
+}
+
+float adcService_getVoltage(adc1_channel_t channel){
+    if (!isRunning || channel >= ADC1_CHANNEL_MAX || !channelData[channel].registered) return -1;
+    if (channelData[channel].updateCount.load(std::memory_order_acquire) == 0) return -1;
+    return adcCal_rawToVoltage(channel, (int)(channelData[channel].value.load(std::memory_order_relaxed) + 0.5));
+}
+
+uint32_t adcService_getUpdateCount(adc1_channel_t channel){
+    if (channel >= ADC1_CHANNEL_MAX) return 0;
+    return channelData[channel].updateCount.load(std::memory_order_acquire);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+extern "C"
+{
+#include <driver/adc.h>
+}
+
+#include <stdint.h>
+
+
+//--- adcChannel_config_t ---
+//sampling schedule of one ADC1 channel registered at the adc service
+typedef struct adcChannel_config_t {
+    adc1_channel_t channel;
+    const char * name;      //used for logging only
+    uint8_t weight;         //conversions per scan cycle (share of the total sample rate, e.g. 4 = sampled 4x as often as channel with 1)
+    uint16_t oversampling;  //raw samples averaged into one published value
+    float filterAlpha;      //low pass applied to published values (1 = off, smaller = stronger filtering)
+} adcChannel_config_t;
+
+
+//=======================================
+//============ ADC service ==============
+//=======================================
+//single owner of ADC1: continuous background sampling of all registered channels using the digital controller (DMA)
+//- channels are scanned in a fixed pattern according to their weight (max SOC_ADC_PATT_LEN_MAX conversions per cycle)
+//- a task drains the dma buffer, averages 'oversampling' samples per channel, filters and publishes the result
+//- published values are stored in a lock-free table => reading is O(1) and never blocks (any task)
+//note: ADC1 oneshot reads (adc1_get_raw) must not be used while the service is running
+//      => every ADC1 channel in use (current sensors, joystick, battery) has to be registered
+
+//configure and start continuous conversion of the registered channels (11dB attenuation, 12 bit)
+//sampleFreqHz: total conversion rate, shared between all channels by weight (ESP32: 20kHz - 2MHz)
+//note: blocks until a first value of every channel is published
+void adcService_init(const adcChannel_config_t * channels, uint8_t count, uint32_t sampleFreqHz);
+
+//true when the service is running (otherwise callers have to use oneshot reads)
+bool adcService_isRunning();
+
+//get latest published raw value (0-4095) of a registered channel, -1 when channel is not registered / service not running
+int adcService_getRaw(adc1_channel_t channel);
+
+//get latest published voltage (0-3.3V) of a registered channel, negative when not available
+//note: converted using eFuse calibration (see adccalibration.hpp)
+float adcService_getVoltage(adc1_channel_t channel);
+
+//get number of values published for a channel since start (e.g. to detect new data)
+uint32_t adcService_getUpdateCount(adc1_channel_t channel);
@@ -5,24 +5,34 @@ extern "C" {
 
 #include <math.h>
 #include "currentsensor.hpp"
+#include "adcservice.hpp"
+#include "adccalibration.hpp"
 
 //tag for logging
 static const char * TAG = "current-sensors";
 
+//zero point drift tracking (see trackZero)
+#define ZERO_TRACK_ALPHA 0.05           //weight of new sample (slow drift only, e.g. temperature)
+#define ZERO_TRACK_MAX_DEVIATION_V 0.08 //samples deviating more from current zero point are rejected (current flowing, noise spike)
+#define ZERO_TRACK_WARN_REJECTED 30     //log warning when that many consecutive samples got rejected
+
 
 
 //--------------------------
 //------- getVoltage -------
 //--------------------------
 //local function to get average voltage from adc
+//uses latest value published by adc service when running (no waiting), multisampling otherwise
 float getVoltage(adc1_channel_t adc, uint32_t samples){
+	float voltageService = adcService_getVoltage(adc);
+	if (voltageService >= 0) return voltageService;
 	//measure voltage
 	int measure = 0;
 	for (int j=0; j<samples; j++){
 		measure += adc1_get_raw(adc);
 		ets_delay_us(50);
 	}
-	return (float)measure / samples / 4096 * 3.3;
+	return adcCal_rawToVoltage(adc, measure / samples);
 }
 
 
@@ -36,9 +46,12 @@ currentSensor::currentSensor (adc1_channel_t adcChannel_f, float ratedCurrent_f,
 	ratedCurrent = ratedCurrent_f;
 	isInverted = isInverted_f;
 	snapToZeroThreshold = snapToZeroThreshold_f;
-	//init adc
-	adc1_config_width(ADC_WIDTH_BIT_12); //max resolution 4096
-	adc1_config_channel_atten(adcChannel, ADC_ATTEN_DB_11); //max voltage
+	//init adc (only needed for oneshot reads, channel is configured by adc service otherwise)
+	if (!adcService_isRunning()){
+		adc1_config_width(ADC_WIDTH_BIT_12); //max resolution 4096
+		adc1_config_channel_atten(adcChannel, ADC_ATTEN_DB_11); //max voltage
+		adcCal_registerChannel(adcChannel, ADC_ATTEN_DB_11);
+	}
 	//calibrate
 	calibrateZeroAmpere();
 }
@@ -48,9 +61,12 @@ currentSensor::currentSensor (adc1_channel_t adcChannel_f, float ratedCurrent_f,
 //============================
 //=========== read ===========
 //============================
-float currentSensor::read(void){
+//note: called from multiple tasks (motor control, display) => no state is written here
+float currentSensor::read(float * voltageSampled){
 	//measure voltage
-	voltage = getVoltage(adcChannel, 30);
+	float voltage = getVoltage(adcChannel, 30);
+	if (voltageSampled != NULL) *voltageSampled = voltage;
+	float current;
 
 	//scale voltage to current
 	if (voltage < centerVoltage){
@@ -70,12 +86,37 @@ float currentSensor::read(void){
 	else if (isInverted)
 		current = -current;
 
-	ESP_LOGI(TAG, "read sensor adc=%d: voltage=%.3fV, centerVoltage=%.3fV => current=%.3fA", (int)adcChannel, voltage, centerVoltage, current);
+	ESP_LOGV(TAG, "read sensor adc=%d: voltage=%.3fV, centerVoltage=%.3fV => current=%.3fA", (int)adcChannel, voltage, centerVoltage, current);
 	return current;
 }
 
 
 
+//=============================
+//========= trackZero =========
+//=============================
+//low pass drift tracking of the zero point with voltage sampled by the caller's read() (no additional sampling, never blocks)
+//note: caller has to ensure no current flows (motor off and wheel stopped for some time)
+bool currentSensor::trackZero(float voltage){
+	float deviation = voltage - centerVoltage;
+	//outlier rejection
+	if (fabs(deviation) > ZERO_TRACK_MAX_DEVIATION_V){
+		zeroRejectedCount++;
+		ESP_LOGD(TAG, "zero tracking adc=%d: rejected voltage=%.3fV (center=%.3fV, %d consecutive)", (int)adcChannel, voltage, centerVoltage, zeroRejectedCount);
+		if (zeroRejectedCount == ZERO_TRACK_WARN_REJECTED)
+			ESP_LOGW(TAG, "zero tracking adc=%d: last %d samples rejected - offset %.3fV too large for tracking (current flowing or sensor fault?)",
+				(int)adcChannel, ZERO_TRACK_WARN_REJECTED, deviation);
+		return false;
+	}
+	zeroRejectedCount = 0;
+	//drift tracking
+	centerVoltage += ZERO_TRACK_ALPHA * deviation;
+	ESP_LOGV(TAG, "zero tracking adc=%d: voltage=%.3fV => center=%.4fV", (int)adcChannel, voltage, centerVoltage);
+	return true;
+}
+
+
+
 //===============================
 //===== calibrateZeroAmpere =====
 //===============================
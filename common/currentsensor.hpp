@@ -9,14 +9,14 @@ class currentSensor{
 	public:
 		currentSensor (adc1_channel_t adcChannel_f, float ratedCurrent, float snapToZeroThreshold, bool inverted = false);
 		void calibrateZeroAmpere(void); //set current voltage to voltage representing 0A
-		float read(void); //get current ampere
+		float read(float * voltageSampled = NULL); //get current ampere, optionally returns the sampled voltage (e.g. for trackZero)
+		bool trackZero(float voltage); //adjust zero point using voltage sampled by caller, only call while no current flows (non blocking), false when rejected as outlier
+		float getCenterVoltage(void) {return centerVoltage;};
 	private:
 		adc1_channel_t adcChannel;
 		float ratedCurrent;
 		bool isInverted;
 		float snapToZeroThreshold;
-		uint32_t measure;
-		float voltage;
-		float current;
 		float centerVoltage = 3.3/2;
+		uint32_t zeroRejectedCount = 0; //consecutive samples rejected by trackZero
 };
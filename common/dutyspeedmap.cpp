@@ -0,0 +1,118 @@
+#include "dutyspeedmap.hpp"
+#include <math.h>
+
+#define DSMAP_VERSION 1
+#define DSMAP_MIN_ALPHA 0.02 //weight of new sample once enough samples were learned (averaging before)
+#define DSMAP_MAX_SAMPLES 60000
+#define DSMAP_MIN_SAMPLES_USED 5 //cell is used once it has that many samples
+
+
+//============================
+//======= constructor ========
+//============================
+dutySpeedMap::dutySpeedMap(float voltageMin_f, float voltageMax_f, float speedAtFullDutyDefault_f){
+    voltageMin = voltageMin_f;
+    voltageMax = voltageMax_f;
+    speedAtFullDutyDefault = speedAtFullDutyDefault_f;
+    data.version = DSMAP_VERSION;
+    for (int v = 0; v < DSMAP_VOLTAGE_BINS; v++)
+        for (int d = 0; d < DSMAP_DUTY_BINS; d++)
+            data.speedAtFullDuty[v][d] = speedAtFullDutyDefault;
+}
+
+
+
+//===========================
+//====== get bin index ======
+//===========================
+int dutySpeedMap::getVoltageBin(float voltage){
+    int bin = (voltage - voltageMin) / (voltageMax - voltageMin) * DSMAP_VOLTAGE_BINS;
+    if (bin < 0) return 0;
+    if (bin >= DSMAP_VOLTAGE_BINS) return DSMAP_VOLTAGE_BINS - 1;
+    return bin;
+}
+
+int dutySpeedMap::getDutyBin(float dutyAbs){
+    int bin = (dutyAbs - DSMAP_MIN_DUTY) / (100 - DSMAP_MIN_DUTY) * DSMAP_DUTY_BINS;
+    if (bin < 0) return 0;
+    if (bin >= DSMAP_DUTY_BINS) return DSMAP_DUTY_BINS - 1;
+    return bin;
+}
+
+
+
+//===========================
+//========== learn ==========
+//===========================
+//update cell with new steady-state sample
+void dutySpeedMap::learn(float duty, float speedKmph, float voltage){
+    if (fabs(duty) < DSMAP_MIN_DUTY || (speedKmph > 0) != (duty > 0)) return;
+    float sample = speedKmph / duty * 100;
+    //reject implausible samples (e.g. wheel blocked or slipping)
+    if (sample < speedAtFullDutyDefault * 0.3 || sample > speedAtFullDutyDefault * 3) return;
+    int v = getVoltageBin(voltage);
+    int d = getDutyBin(fabs(duty));
+    //average of first samples, then moving average (table adapts to e.g. tire wear)
+    uint16_t * count = &data.samples[v][d];
+    if (*count < DSMAP_MAX_SAMPLES) (*count)++;
+    float alpha = fmaxf(1.0 / *count, DSMAP_MIN_ALPHA);
+    data.speedAtFullDuty[v][d] += alpha * (sample - data.speedAtFullDuty[v][d]);
+    changed = true;
+}
+
+
+
+//========================================
+//========== getSpeedAtFullDuty ==========
+//========================================
+//learned value of cell, fall back to nearest learned cell with same voltage, then default
+float dutySpeedMap::getSpeedAtFullDuty(float duty, float voltage){
+    int v = getVoltageBin(voltage);
+    int d = getDutyBin(fabs(duty));
+    for (int offset = 0; offset < DSMAP_DUTY_BINS; offset++){
+        if (d - offset >= 0 && data.samples[v][d - offset] >= DSMAP_MIN_SAMPLES_USED)
+            return data.speedAtFullDuty[v][d - offset];
+        if (d + offset < DSMAP_DUTY_BINS && data.samples[v][d + offset] >= DSMAP_MIN_SAMPLES_USED)
+            return data.speedAtFullDuty[v][d + offset];
+    }
+    return speedAtFullDutyDefault;
+}
+
+
+
+//=============================
+//========== getDuty ==========
+//=============================
+//duty depends on the bin which depends on duty => estimate with default first, then use cell of that duty
+float dutySpeedMap::getDuty(float speedKmph, float voltage){
+    float dutyEstimate = speedKmph / getSpeedAtFullDuty(speedKmph / speedAtFullDutyDefault * 100, voltage) * 100;
+    float duty = speedKmph / getSpeedAtFullDuty(dutyEstimate, voltage) * 100;
+    if (duty > 100) return 100;
+    if (duty < -100) return -100;
+    return duty;
+}
+
+
+
+//=============================
+//========== setData ==========
+//=============================
+bool dutySpeedMap::setData(const dutySpeedMap_data_t &dataNew){
+    if (dataNew.version != DSMAP_VERSION) return false;
+    data = dataNew;
+    changed = false;
+    return true;
+}
+
+
+
+//====================================
+//========== getSampleCount ==========
+//====================================
+uint32_t dutySpeedMap::getSampleCount(){
+    uint32_t sum = 0;
+    for (int v = 0; v < DSMAP_VOLTAGE_BINS; v++)
+        for (int d = 0; d < DSMAP_DUTY_BINS; d++)
+            sum += data.samples[v][d];
+    return sum;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//--- table size ---
+#define DSMAP_VOLTAGE_BINS 6 //battery voltage range split into that many bins
+#define DSMAP_DUTY_BINS 4    //duty range DSMAP_MIN_DUTY-100% split into that many bins
+#define DSMAP_MIN_DUTY 15    //not learned at lower duty (friction dominates)
+
+
+//--- dutySpeedMap_data_t ---
+//learned table, stored in nvs as one blob
+typedef struct dutySpeedMap_data_t {
+    uint16_t version; //layout version, table stored with other layout is discarded
+    uint16_t samples[DSMAP_VOLTAGE_BINS][DSMAP_DUTY_BINS]; //count of samples learned per cell (saturates)
+    float speedAtFullDuty[DSMAP_VOLTAGE_BINS][DSMAP_DUTY_BINS]; //km/h at 100% duty (speed / duty)
+} dutySpeedMap_data_t;
+
+
+//==================================
+//======= dutySpeedMap class =======
+//==================================
+//steady-state relation between duty and wheel speed, learned during normal driving
+//- binned by battery voltage (speed at same duty drops with voltage) and duty (non-linear at low duty, load)
+//- each cell stores speed at 100% duty, cells without samples use learned cells of same voltage or default value
+//- used as feedforward by closed-loop control modes and for flying restart
+class dutySpeedMap {
+    public:
+        //--- functions ---
+        dutySpeedMap(float voltageMin, float voltageMax, float speedAtFullDutyDefault);
+
+        //add sample measured at constant duty (signed duty and speed, same direction)
+        void learn(float duty, float speedKmph, float voltage);
+        //get duty at which the motor runs at provided speed (signed) with current battery voltage
+        float getDuty(float speedKmph, float voltage);
+        //get learned speed at 100% duty for certain duty and voltage
+        float getSpeedAtFullDuty(float duty, float voltage);
+
+        //--- persistence ---
+        const dutySpeedMap_data_t * getData() const {return &data;};
+        bool setData(const dutySpeedMap_data_t &dataNew); //restore table (e.g. from nvs), false when layout does not match
+        bool isChanged() const {return changed;}; //learned new samples since last clearChanged()
+        void clearChanged() {changed = false;};
+        uint32_t getSampleCount();
+
+    private:
+        //--- functions ---
+        int getVoltageBin(float voltage);
+        int getDutyBin(float dutyAbs);
+
+        //--- variables ---
+        float voltageMin;
+        float voltageMax;
+        float speedAtFullDutyDefault;
+        dutySpeedMap_data_t data = {};
+        bool changed = false;
+};
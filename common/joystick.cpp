@@ -3,6 +3,7 @@ extern "C" {
 }
 
 #include "joystick.hpp"
+#include "adcservice.hpp"
 
 
 //definition of string array to be able to convert state enum to readable string
@@ -32,15 +33,17 @@ evaluatedJoystick::evaluatedJoystick(joystick_config_t config_f, nvs_handle_t *
 //----------------------------
 void evaluatedJoystick::init(){
     ESP_LOGW(TAG, "initializing ADC's and loading calibration...");
-    //initialize adc
-    adc1_config_width(ADC_WIDTH_BIT_12); //=> max resolution 4096
+    //initialize adc (only needed for oneshot reads, channels are configured by adc service otherwise)
+    if (!adcService_isRunning()) {
+        adc1_config_width(ADC_WIDTH_BIT_12); //=> max resolution 4096
                                          
-    //FIXME: the following two commands each throw error 
-    //"ADC: adc1_lock_release(419): adc1 lock release called before acquire"
-    //note: also happens for each get_raw for first call of readAdc function
-    //when run in main function that does not happen -> move init from constructor to be called in main
-    adc1_config_channel_atten(config.adc_x, ADC_ATTEN_DB_11); //max voltage
-    adc1_config_channel_atten(config.adc_y, ADC_ATTEN_DB_11); //max voltage
+        //FIXME: the following two commands each throw error 
+        //"ADC: adc1_lock_release(419): adc1 lock release called before acquire"
+        //note: also happens for each get_raw for first call of readAdc function
+        //when run in main function that does not happen -> move init from constructor to be called in main
+        adc1_config_channel_atten(config.adc_x, ADC_ATTEN_DB_11); //max voltage
+        adc1_config_channel_atten(config.adc_y, ADC_ATTEN_DB_11); //max voltage
+    }
 
     //load stored calibration values (if not found loads defaults from config)
     loadCalibration(X_MIN);
@@ -58,14 +61,18 @@ void evaluatedJoystick::init(){
 //--------- readAdc -----------
 //-----------------------------
 //function for multisampling an anlog input
+//uses latest value published by adc service when running (oneshot reads not allowed then)
 int evaluatedJoystick::readAdc(adc1_channel_t adc_channel, bool inverted) {
-    //make multiple measurements
-    int adc_reading = 0;
-    for (int i = 0; i < 16; i++) {
-        adc_reading += adc1_get_raw(adc_channel);
-		ets_delay_us(50);
+    int adc_reading = adcService_getRaw(adc_channel);
+    if (adc_reading < 0) {
+        //make multiple measurements
+        adc_reading = 0;
+        for (int i = 0; i < 16; i++) {
+            adc_reading += adc1_get_raw(adc_channel);
+            ets_delay_us(50);
+        }
+        adc_reading = adc_reading / 16;
     }
-    adc_reading = adc_reading / 16;
 
     //return original or inverted result
     if (inverted) {
@@ -91,14 +98,14 @@ joystickData_t evaluatedJoystick::getData() {
     float x = scaleCoordinate(readAdc(config.adc_x, config.x_inverted), x_min, x_max, x_center,  config.tolerance_zeroX_per, config.tolerance_end_per);
     data.x = x;
 	ESP_LOGD(TAG, "X: adc-raw=%d \tadc-conv=%d \tmin=%d \t max=%d \tcenter=%d \tinverted=%d => x=%.3f",
-        adc1_get_raw(config.adc_x), adcRead,  x_min, x_max, x_center, config.x_inverted, x);
+        readAdc(config.adc_x, false), adcRead,  x_min, x_max, x_center, config.x_inverted, x);
 
     ESP_LOGV(TAG, "getting Y coodrinate...");
 	adcRead = readAdc(config.adc_y, config.y_inverted);
     float y = scaleCoordinate(adcRead, y_min, y_max, y_center,  config.tolerance_zeroY_per, config.tolerance_end_per);
     data.y = y;
 	ESP_LOGD(TAG, "Y: adc-raw=%d \tadc-conv=%d \tmin=%d \t max=%d \tcenter=%d \tinverted=%d => y=%.3lf",
-        adc1_get_raw(config.adc_y), adcRead,  y_min, y_max, y_center, config.y_inverted, y);
+        readAdc(config.adc_y, false), adcRead,  y_min, y_max, y_center, config.y_inverted, y);
 
     //calculate radius
     data.radius = sqrt(pow(data.x,2) + pow(data.y,2));
@@ -1,24 +1,157 @@
 #include "motorctl.hpp"
 #include "esp_log.h"
 #include "types.hpp"
+#include "adcservice.hpp"
 
 //tag for logging
 static const char * TAG = "motor-control";
 
 #define TIMEOUT_IDLE_WHEN_NO_COMMAND 15000 // turn motor off when still on and no new command received within that time
-#define TIMEOUT_QUEUE_WHEN_AT_TARGET 5000  // time waited for new command when motors at target duty (e.g. IDLE) (no need to handle fading in fast loop)
+#define TCS_MIN_SPEED_KMH 1 //must be at least that fast for TCS to be enabled
+#define TIMEOUT_WAKE_WHEN_AT_TARGET 5000  // time waited for new command when motors at target duty but not off (regular driver update, check command timeout)
+#define TIMEOUT_WAKE_WHEN_IDLE 1000 // time waited for new command when both motors are off (background zero-current tracking)
+#define BATTERY_VOLTAGE_UPDATE_INTERVAL_MS 2000 // interval battery voltage is read and passed to motors
 
 //====================================
 //========== motorctl task ===========
 //====================================
-//task for handling the motors (ramp, current limit, driver)
-void task_motorctl( void * ptrControlledMotor ){
-    //get pointer to controlledMotor instance from task parameter
-    controlledMotor * motor = (controlledMotor *)ptrControlledMotor;
-    ESP_LOGW(TAG, "Task-motorctl [%s]: starting handle loop...", motor->getName());
+//--- onControlTimer ---
+//esp_timer callback that wakes the motorctl task once every control period
+//note: runs in esp_timer task (ESP_TIMER_TASK dispatch)
+static void onControlTimer(void * taskHandle){
+    xTaskNotify((TaskHandle_t)taskHandle, MOTORCTL_NOTIFY_TICK, eSetBits);
+}
+
+//--- arbitratePowerBudget ---
+//divide total power budget between both motors (sets current budget used by current limit in handle)
+//- budget is split proportional to target duty => wheel that is commanded more (e.g. outer wheel in a curve) gets more
+//- share not used by the other motor is available as well
+//note: uses currents measured in last cycle
+static void arbitratePowerBudget(controlledMotor * motorLeft, controlledMotor * motorRight, float powerBudgetW){
+    float voltage = motorLeft->getBatteryVoltage();
+    //disabled or battery voltage not known yet
+    if (powerBudgetW <= 0 || voltage <= 0){
+        motorLeft->setCurrentBudget(INFINITY);
+        motorRight->setCurrentBudget(INFINITY);
+        return;
+    }
+    float currentTotal = powerBudgetW / voltage;
+    float currentLeft = fabs(motorLeft->getCurrentLastCycle());
+    float currentRight = fabs(motorRight->getCurrentLastCycle());
+    //weight by commanded duty (+1 => equal split when both are off)
+    float weightLeft = fabs(motorLeft->getTargetDuty()) + 1;
+    float weightRight = fabs(motorRight->getTargetDuty()) + 1;
+    float shareLeft = currentTotal * weightLeft / (weightLeft + weightRight);
+    float shareRight = currentTotal - shareLeft;
+    //allow using what the other motor does not need
+    motorLeft->setCurrentBudget(fmaxf(shareLeft, currentTotal - currentRight));
+    motorRight->setCurrentBudget(fmaxf(shareRight, currentTotal - currentLeft));
+}
+
+//task for handling both motors (ramp, current limit, driver)
+//handle() is run at a fixed rate, so ramp, current limit and tcs calculations have a steady time base
+//(previously the cycle length depended on the duration of handle itself plus a fixed delay)
+//both motors are handled in lock-step in one task: same snapshot of both sides, driver commands are sent together
+//event driven: the periodic timer only runs while a motor needs it (fading, active current limit / tcs / abs, closed loop mode),
+//otherwise the task sleeps until a new command arrives (notification from setTarget)
+void task_motorctl( void * task_motorctl_parameters ){
+    //get pointer to controlledMotor instances and period from task parameter
+    motorctl_task_parameters_t * params = (motorctl_task_parameters_t *)task_motorctl_parameters;
+    controlledMotor * motorLeft = params->motorLeft;
+    controlledMotor * motorRight = params->motorRight;
+    motorLeft->setControlPeriod(params->usControlPeriod);
+    motorRight->setControlPeriod(params->usControlPeriod);
+    //new commands wake this task
+    motorLeft->setControlTask(xTaskGetCurrentTaskHandle());
+    motorRight->setControlTask(xTaskGetCurrentTaskHandle());
+
+    //create periodic timer that notifies this task
+    const esp_timer_create_args_t timerArgs = {
+        .callback = &onControlTimer,
+        .arg = xTaskGetCurrentTaskHandle(),
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "motorctl-tick"};
+    esp_timer_handle_t timer;
+    ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, params->usControlPeriod));
+    bool timerRunning = true;
+    ESP_LOGW(TAG, "Task-motorctl [%s, %s]: starting handle loop with period %dus...", motorLeft->getName(), motorRight->getName(), params->usControlPeriod);
+
+    int64_t timestampLastTick = 0;
+    uint32_t timestampBatteryVoltageUpdate = 0;
     while(1){
-        motor->handle();
-        vTaskDelay(20 / portTICK_PERIOD_MS);
+        //--- wait for tick or new command ---
+        //when timer is stopped only new commands wake the task
+        //(with timeout while a motor is still on: regular driver update and no-command timeout,
+        // slow wakeup while both are off: zero-current tracking of current sensors)
+        TickType_t timeout = portMAX_DELAY;
+        if (!timerRunning && (motorLeft->getDuty() != 0 || motorRight->getDuty() != 0))
+            timeout = TIMEOUT_WAKE_WHEN_AT_TARGET / portTICK_PERIOD_MS;
+        else if (!timerRunning)
+            timeout = TIMEOUT_WAKE_WHEN_IDLE / portTICK_PERIOD_MS;
+        uint32_t notifyValue = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &notifyValue, timeout);
+        int64_t timestampWake = esp_timer_get_time();
+
+        //--- update battery voltage ---
+        //used for duty-speed map and power budget, only cheap when published by adc service (no blocking oneshot reads)
+        if (params->getBatteryVoltage != NULL && adcService_isRunning()
+            && (timestampBatteryVoltageUpdate == 0 || esp_log_timestamp() - timestampBatteryVoltageUpdate > BATTERY_VOLTAGE_UPDATE_INTERVAL_MS)){
+            timestampBatteryVoltageUpdate = esp_log_timestamp();
+            float voltage = params->getBatteryVoltage();
+            motorLeft->setBatteryVoltage(voltage);
+            motorRight->setBatteryVoltage(voltage);
+        }
+
+        //divide power budget between both motors
+        arbitratePowerBudget(motorLeft, motorRight, params->powerBudgetW);
+
+        //take one consistent snapshot of both sides
+        motorSnapshot_t snapshotLeft = motorLeft->getSnapshot();
+        motorSnapshot_t snapshotRight = motorRight->getSnapshot();
+
+        //calculate new duty of both motors using the same data
+        motorLeft->handle(snapshotLeft, snapshotRight);
+        motorRight->handle(snapshotRight, snapshotLeft);
+
+        //send both driver commands together (no skew between left and right)
+        motorLeft->applyCommand();
+        motorRight->applyCommand();
+
+        //--- persist learned data ---
+        //nvs write stalls flash access of the whole chip => only while both motors are stopped
+        if (motorLeft->isStopped() && motorRight->isStopped()){
+            motorLeft->persistLearnedData();
+            motorRight->persistLearnedData();
+        }
+
+        //--- update timing statistics ---
+        //only intervals between consecutive ticks count (not wakeups by command)
+        if (notifyValue & MOTORCTL_NOTIFY_TICK){
+            if (timestampLastTick != 0){
+                int64_t usInterval = timestampWake - timestampLastTick;
+                int64_t usExecution = esp_timer_get_time() - timestampWake;
+                int64_t ticks = (usInterval + params->usControlPeriod / 2) / params->usControlPeriod;
+                uint32_t ticksMissed = ticks > 1 ? ticks - 1 : 0;
+                motorLeft->recordLoopTiming(usInterval, usExecution, ticksMissed);
+                motorRight->recordLoopTiming(usInterval, usExecution, ticksMissed);
+            }
+            timestampLastTick = timestampWake;
+        }
+
+        //--- start/stop periodic timer ---
+        bool needsTick = motorLeft->needsTick() || motorRight->needsTick();
+        if (needsTick && !timerRunning){
+            esp_timer_start_periodic(timer, params->usControlPeriod);
+            timerRunning = true;
+            ESP_LOGD(TAG, "resuming control timer");
+        }
+        else if (!needsTick && timerRunning){
+            esp_timer_stop(timer);
+            timerRunning = false;
+            timestampLastTick = 0; //first interval after restart is not a regular period
+            ESP_LOGD(TAG, "both motors at target -> stopped control timer");
+        }
     }
 }
 
@@ -28,10 +161,24 @@ void task_motorctl( void * ptrControlledMotor ){
 //======== constructor ========
 //=============================
 //constructor, simultaniously initialize instance of motor driver 'motor' and current sensor 'cSensor' with provided config (see below lines after ':')
-controlledMotor::controlledMotor(motorSetCommandFunc_t setCommandFunc,  motorctl_config_t config_control, nvs_handle_t * nvsHandle_f, speedSensor * speedSensor_f, controlledMotor ** otherMotor_f):
+controlledMotor::controlledMotor(motorSetCommandFunc_t setCommandFunc,  motorctl_config_t config_control, nvs_handle_t * nvsHandle_f, speedSensor * speedSensor_f):
     //create current sensor
 	cSensor(config_control.currentSensor_adc, config_control.currentSensor_ratedCurrent, config_control.currentSnapToZeroThreshold, config_control.currentInverted),
-    configDefault(config_control){
+    configDefault(config_control),
+    //create speed controller
+    speedPid({config_control.speedControlKp, config_control.speedControlKi, config_control.speedControlKd}, -config_control.speedControlMaxDuty, config_control.speedControlMaxDuty),
+    //create current controller (PI)
+    currentPid({config_control.currentControlKp, config_control.currentControlKi, 0}, -100, 100),
+    //create outer speed controller of cascaded mode (output is target current)
+    cascadeSpeedPid({config_control.cascadeSpeedKp, config_control.cascadeSpeedKi, 0}, -config_control.currentMax, config_control.currentMax),
+    //create duty-speed map (values loaded from nvs in init)
+    dsMap(config_control.dsMapVoltageMin, config_control.dsMapVoltageMax, config_control.speedAtFullDutyKmh),
+    //create thermal models (continuous limit is currentMax)
+    thermalMotor({config_control.currentMax, config_control.currentPeak, config_control.thermalTauMotorS, config_control.thermalTaperStartLoad}),
+    thermalDriver({config_control.currentMax, config_control.currentPeak, config_control.thermalTauDriverS, config_control.thermalTaperStartLoad}),
+    //create traction control
+    tcs({config_control.tcsAccelPerAmpere, config_control.tcsMaxAccelExcessKmhs, config_control.tcsMaxSpeedExcessKmh, TCS_MIN_SPEED_KMH, config_control.tcsRestoreRate,
+         config_control.absMaxDecelKmhs, config_control.absReleaseFactor, config_control.absReapplyRate}){
 		//copy parameters for controlling the motor
 		config = config_control;
         log = config.loggingEnabled;
@@ -39,8 +186,6 @@ controlledMotor::controlledMotor(motorSetCommandFunc_t setCommandFunc,  motorctl
 		motorSetCommand = setCommandFunc;
         //pointer to nvs handle
         nvsHandle = nvsHandle_f;
-        //pointer to other motor object
-        ppOtherMotor = otherMotor_f;
         //pointer to speed sensor
         sSensor = speedSensor_f;
 
@@ -63,11 +208,13 @@ void controlledMotor::init(){
     // load config values from nvs, otherwise use default from config object
     loadAccelDuration();
     loadDecelDuration();
+    loadSpeedControlGains();
+    loadDutySpeedMap();
 
     // turn motor off initially
     motorSetCommand({motorstate_t::IDLE, 0.00});
 
-    //cSensor.calibrateZeroAmpere(); //currently done in currentsensor constructor TODO do this regularly e.g. in idle?
+    //note: initial zero calibration is done in currentsensor constructor, drift is tracked while idle (see handle)
 }
 
 
@@ -78,7 +225,7 @@ void controlledMotor::init(){
 //local function that fades a variable
 //- increments a variable (pointer) by given value
 //- sets to target if already closer than increment
-//TODO this needs testing
+//note: used for reducing duty by a certain amount (e.g. traction control), regular ramp is handled by rampGenerator
 void fade(float * dutyNow, float dutyTarget, float dutyIncrement){
     float dutyDelta = dutyTarget - *dutyNow; 
     if ( fabs(dutyDelta) > fabs(dutyIncrement) ) { //check if already close to target
@@ -92,6 +239,18 @@ void fade(float * dutyNow, float dutyTarget, float dutyIncrement){
 
 
 
+//----------------------
+//----- rateFromMs -----
+//----------------------
+//local function that converts configured fade time (ms from 0 to 100%) to a rate in %/s
+//0 = no limit
+float rateFromMs(uint32_t msFade){
+    if (msFade == 0) return RAMP_UNLIMITED;
+    return 100 / ((float)msFade / 1000);
+}
+
+
+
 //----------------------------
 //----- getStateFromDuty -----
 //----------------------------
@@ -104,23 +263,43 @@ motorstate_t getStateFromDuty(float duty){
 
 
 
+//===============================
+//========= getSnapshot =========
+//===============================
+//get current state of this motor
+//note: taken for both motors before handle() of either motor runs, so both work with the same data
+motorSnapshot_t controlledMotor::getSnapshot(){
+    speedSensor_state_t speed = sSensor->getState(); //one consistent read of the speed sensor
+    motorSnapshot_t snapshot = {
+        .speedKmph = speed.speedKmph,
+        .accelKmphs = speed.accelKmphs,
+        .timeLastSpeedUpdate = speed.timeUpdate,
+        .speedTarget = speedTarget,
+        .dutyTarget = dutyTarget,
+        .dutyNow = dutyNow,
+        .speedAtFullDutyKmh = getSpeedAtFullDuty(dutyNow)
+    };
+    return snapshot;
+}
+
+
+
 //==============================
 //=========== handle ===========
 //==============================
-//function that controls the motor driver and handles fading/ramp, current limit and deadtime
-void controlledMotor::handle(){
-
-    //TODO: History: skip fading when motor was running fast recently / alternatively add rot-speed sensor
+//function that calculates the new motor duty and handles fading/ramp, current limit and deadtime
+//note: the resulting command is sent to the motor driver by applyCommand()
+void controlledMotor::handle(const motorSnapshot_t &snapshotThis, const motorSnapshot_t &snapshotOther){
 
     //--- RECEIVE DATA FROM QUEUE ---
-    if( xQueueReceive( commandQueue, &commandReceive, timeoutWaitForCommand / portTICK_PERIOD_MS ) ) //wait time is always 0 except when at target duty already
+    // note: never blocks (both motors are handled in the same task, which is woken by setTarget)
+    if( xQueueReceive( commandQueue, &commandReceive, 0 ) )
     {
         if(log) ESP_LOGV(TAG, "[%s] Read command from queue: state=%s, duty=%.2f", config.name, motorstateStr[(int)commandReceive.state], commandReceive.duty);
         state = commandReceive.state;
         dutyTarget = commandReceive.duty;
 		receiveTimeout = false;
 		timestamp_commandReceived = esp_log_timestamp();
-
     }
 
 
@@ -130,8 +309,9 @@ void controlledMotor::handle(){
 // ----- EXPERIMENTAL, DIFFERENT MODES -----
 // define target duty differently depending on current contro-mode
 //declare variables used inside switch
-float ampereNow, ampereTarget, ampereDiff;
-float speedDiff;
+float ampereTarget;
+float dtSeconds;
+float dutyFeedforward;
     switch (mode)
     {
     case motorControlMode_t::DUTY: // regulate to desired duty (as originally)
@@ -159,101 +339,98 @@ float speedDiff;
         }
         break;
 
-#define CURRENT_CONTROL_ALLOWED_AMPERE_DIFF 1 //difference from target where no change is made yet
-#define CURRENT_CONTROL_MIN_AMPERE 0.7 //current where motor is turned off
-//TODO define different, fixed fading configuration in current mode, fade down can be significantly less (500/500ms fade up worked fine)
-    case motorControlMode_t::CURRENT: // regulate to desired current flow
-        ampereNow = cSensor.read();
+    case motorControlMode_t::CURRENT: // regulate to desired current flow using pi controller
+        //stop when target is 0
+        if (commandReceive.duty == 0 || commandReceive.state == motorstate_t::IDLE || commandReceive.state == motorstate_t::BRAKE) {
+            dutyTarget = 0;
+            currentControlActive = false;
+            break;
+        }
         ampereTarget = config.currentMax * commandReceive.duty / 100; // TODO ensure input data is 0-100 (no duty max), add currentMax to menu/config
         if (commandReceive.state == motorstate_t::REV) ampereTarget = - ampereTarget; //target is negative when driving reverse
-        ampereDiff = ampereTarget - ampereNow;
-        if(log) ESP_LOGV("TESTING", "[%s] CURRENT-CONTROL: ampereNow=%.2f, ampereTarget=%.2f, diff=%.2f", config.name, ampereNow, ampereTarget, ampereDiff); // todo handle brake
+        runCurrentControl(ampereTarget, commandReceive.state == motorstate_t::REV, snapshotThis.speedKmph);
+        break;
+
+#define SPEED_CONTROL_MAX_DT_S 0.1 //limit time passed used for pid calculation (e.g. first run after skipped cycles)
+    case motorControlMode_t::SPEED: // regulate to desired speed using pid controller
+        speedNow = snapshotThis.speedKmph;
+
+        //caculate target speed from input
+        speedTarget = config.speedControlMaxKmh * commandReceive.duty / 100;
+        // target speed negative when driving reverse
+        if (commandReceive.state == motorstate_t::REV)
+            speedTarget = -speedTarget;
 
-        //--- when IDLE to keep the current at target zero motor needs to be on for some duty (to compensate generator current) 
-        if (commandReceive.duty == 0 && fabs(ampereNow) < CURRENT_CONTROL_MIN_AMPERE){ //stop motors completely when current is very low already
+        //stop when target is 0
+        if (commandReceive.duty == 0 || commandReceive.state == motorstate_t::IDLE || commandReceive.state == motorstate_t::BRAKE) {
+            if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: OFF, target is 0... current-speed=%.2f", config.name, speedNow);
             dutyTarget = 0;
+            speedControlActive = false;
+            break;
         }
-        else if (fabs(ampereDiff) > CURRENT_CONTROL_ALLOWED_AMPERE_DIFF || commandReceive.duty == 0) //#### BOOST BY 1 A
-        {
-            if (ampereDiff > 0 && commandReceive.state != motorstate_t::REV) // forward need to increase current
-            {
-                dutyTarget = 100; // todo add custom fading depending on diff? currently very dependent of fade times
-            }
-            else if (ampereDiff < 0 && commandReceive.state != motorstate_t::FWD) // backward need to increase current (more negative)
-            {
-                dutyTarget = -100;
-            }
-            else // fwd too much, rev too much -> decrease
-            {
-                dutyTarget = 0;
-            }
-            if(log) ESP_LOGV("TESTING", "[%s] CURRENT-CONTROL: set target to %.0f%%", config.name, dutyTarget);
-        }
+
+        //limit output to direction of command (dont actively drive in other direction to slow down)
+        if (commandReceive.state == motorstate_t::REV)
+            speedPid.setOutputLimits(-config.speedControlMaxDuty, 0);
         else
-        {
-            dutyTarget = dutyNow; // target current reached
-            if(log) ESP_LOGD("TESTING", "[%s] CURRENT-CONTROL: target current %.3f reached", config.name, dutyTarget);
+            speedPid.setOutputLimits(0, config.speedControlMaxDuty);
+
+        //feedforward: duty the motor runs with at target speed (learned), controller only corrects the difference
+        dutyFeedforward = getDutyFromSpeed(speedTarget);
+
+        //start from current duty when controller was inactive (no jump)
+        if (!speedControlActive) {
+            speedPid.reset(dutyNow - dutyFeedforward);
+            speedControlActive = true;
         }
+
+        //run pid controller with time passed since last cycle
+        dtSeconds = (esp_timer_get_time() - timestampLastRunUs) / 1000000.0;
+        if (dtSeconds > SPEED_CONTROL_MAX_DT_S) dtSeconds = SPEED_CONTROL_MAX_DT_S;
+        dutyTarget = speedPid.update(speedTarget, speedNow, dtSeconds, dutyFeedforward);
+        if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: target-speed=%.2f, current-speed=%.2f => duty-target=%.1f%% (saturated=%d)", config.name, speedTarget, speedNow, dutyTarget, speedPid.isSaturated());
+
         break;
 
-#define SPEED_CONTROL_MAX_SPEED_KMH 10
-#define SPEED_CONTROL_ALLOWED_KMH_DIFF 0.6
-#define SPEED_CONTROL_MIN_SPEED 0.7 //" start from standstill" always accelerate to this speed, ignoring speedsensor data
-    case motorControlMode_t::SPEED: // regulate to desired speed
-        speedNow = sSensor->getKmph();
-    
+    case motorControlMode_t::CASCADED: // regulate to desired speed: outer speed loop defines target current of inner current loop
+        speedNow = snapshotThis.speedKmph;
+
         //caculate target speed from input
-        speedTarget = SPEED_CONTROL_MAX_SPEED_KMH * commandReceive.duty / 100; // TODO add maxSpeed to config
+        speedTarget = config.speedControlMaxKmh * commandReceive.duty / 100;
         // target speed negative when driving reverse
         if (commandReceive.state == motorstate_t::REV)
             speedTarget = -speedTarget;
-    if (sSensor->getTimeLastUpdate() != timestamp_speedLastUpdate ){ //only modify duty when new speed data available
-        timestamp_speedLastUpdate = sSensor->getTimeLastUpdate(); //TODO get time only once
-        speedDiff = speedTarget - speedNow;
-    } else {
-        if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: no new speed data, not changing duty", config.name);
-        speedDiff = 0;
-    }
-        if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: target-speed=%.2f, current-speed=%.2f, diff=%.3f", config.name, speedTarget, speedNow, speedDiff);
 
         //stop when target is 0
-        if (commandReceive.duty == 0) { //TODO add IDLE, BRAKE state
-        if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: OFF, target is 0... current-speed=%.2f, diff=%.3f", config.name, speedNow, speedDiff);
+        if (commandReceive.duty == 0 || commandReceive.state == motorstate_t::IDLE || commandReceive.state == motorstate_t::BRAKE) {
             dutyTarget = 0;
+            cascadeActive = false;
+            currentControlActive = false;
+            break;
         }
-        else if (fabs(speedNow) < SPEED_CONTROL_MIN_SPEED){ //start from standstill or too slow (not enough speedsensor data)
-            if (log)
-                ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: starting from standstill -> increase duty... target-speed=%.2f, current-speed=%.2f, diff=%.3f", config.name, speedTarget, speedNow, speedDiff);
-            if (commandReceive.state == motorstate_t::FWD)
-            dutyTarget = 100;
-            else if (commandReceive.state == motorstate_t::REV)
-            dutyTarget = -100;
-        }
-        else if (fabs(speedDiff) > SPEED_CONTROL_ALLOWED_KMH_DIFF) //speed too fast/slow
-        {
-            if (speedDiff > 0 && commandReceive.state != motorstate_t::REV) // forward need to increase speed
-            {
-                // TODO retain max duty here
-                dutyTarget = 100; // todo add custom fading depending on diff? currently very dependent of fade times
-            if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: speed to low (fwd), diff=%.2f, increasing set target from %.1f%% to %.1f%%", config.name, speedDiff, dutyNow, dutyTarget);
-            }
-            else if (speedDiff < 0 && commandReceive.state != motorstate_t::FWD) // backward need to increase speed (more negative)
-            {
-                dutyTarget = -100;
-            if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: speed to low (rev), diff=%.2f, increasing set target from %.1f%% to %.1f%%", config.name, speedDiff, dutyNow, dutyTarget);
-            }
-            else // fwd too much, rev too much -> decrease
-            {
-                dutyTarget = 0;
-            if(log) ESP_LOGV("TESTING", "[%s] SPEED-CONTROL: speed to high, diff=%.2f, decreasing set target from %.1f%% to %.1f%%", config.name, speedDiff, dutyNow, dutyTarget);
+
+        //--- outer loop (speed => target current) ---
+        //runs slower than inner loop
+        if (!cascadeActive || esp_timer_get_time() - timestamp_cascadeLastRun >= config.cascadeSpeedPeriodMs * 1000) {
+            dtSeconds = (esp_timer_get_time() - timestamp_cascadeLastRun) / 1000000.0;
+            if (dtSeconds > SPEED_CONTROL_MAX_DT_S) dtSeconds = SPEED_CONTROL_MAX_DT_S;
+            timestamp_cascadeLastRun = esp_timer_get_time();
+            //target current limited to currentMax and direction of command
+            if (commandReceive.state == motorstate_t::REV)
+                cascadeSpeedPid.setOutputLimits(-config.currentMax, 0);
+            else
+                cascadeSpeedPid.setOutputLimits(0, config.currentMax);
+            //start without target current when just activated
+            if (!cascadeActive) {
+                cascadeSpeedPid.reset(0);
+                cascadeActive = true;
             }
-        }
-        else
-        {
-            dutyTarget = dutyNow; // target speed reached
-            if(log) ESP_LOGD("TESTING", "[%s] SPEED-CONTROL: target speed %.3f reached", config.name, speedTarget);
+            cascadeAmpereTarget = cascadeSpeedPid.update(speedTarget, speedNow, dtSeconds);
+            if(log) ESP_LOGV("TESTING", "[%s] CASCADED-CONTROL: target-speed=%.2f, current-speed=%.2f => target-current=%.2fA", config.name, speedTarget, speedNow, cascadeAmpereTarget);
         }
 
+        //--- inner loop (current => duty) ---
+        runCurrentControl(cascadeAmpereTarget, commandReceive.state == motorstate_t::REV, speedNow);
         break;
     }
 
@@ -281,69 +458,139 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
 
 
     //--- DETECT ALREADY AT TARGET ---
-    // when already at exact target duty there is no need to run very fast to handle fading
-    //-> slow down loop by waiting significantly longer for new commands to arrive
-    if (mode != motorControlMode_t::CURRENT  //dont slow down when in CURRENT mode at all
-    && ((dutyDelta == 0 && !config.currentLimitEnabled && !config.tractionControlSystemEnabled && mode != motorControlMode_t::SPEED) //when neither of current-limit, tractioncontrol or speed-mode is enabled slow down when target reached 
-    || (dutyTarget == 0 && dutyNow == 0))) //otherwise only slow down when when actually off
+    // when already at exact target duty there is no need to run periodically to handle fading
+    //-> task_motorctl stops the control timer until new commands arrive (see needsTick())
+    //keep running while a controller regulates or a limit is actually active / close to becoming active
+    //note: current of last cycle, below the continuous current the thermal limit can not cut in
+    #define LIMIT_TICK_CURRENT_MARGIN 0.9 //keep running when current exceeds that share of continuous current or budget
+    bool closedLoopActive = (mode == motorControlMode_t::SPEED && speedControlActive)
+                         || ((mode == motorControlMode_t::CURRENT || mode == motorControlMode_t::CASCADED) && currentControlActive);
+    bool limitActive = currentLimitActive || tcs_isExceeded || tcs.isLimiting() || abs_isActive
+                    || (config.currentLimitEnabled && fabs(currentNow) > LIMIT_TICK_CURRENT_MARGIN * config.currentMax)
+                    || fabs(currentNow) > LIMIT_TICK_CURRENT_MARGIN * currentBudget;
+    if ((dutyDelta == 0 && !closedLoopActive && !limitActive) //target reached and nothing regulates => slow down
+        || (dutyTarget == 0 && dutyNow == 0 && !closedLoopActive)) //always slow down when actually off
     {
-        //increase queue timeout when duty is the same (once)
-        if (timeoutWaitForCommand == 0)
+        if (!atTarget)
         { // TODO verify if state matches too?
-            if(log) ESP_LOGI(TAG, "[%s] already at target duty %.2f, slowing down...", config.name, dutyTarget);
-            timeoutWaitForCommand = TIMEOUT_QUEUE_WHEN_AT_TARGET; // wait in queue very long, for new command to arrive
+            if(log) ESP_LOGI(TAG, "[%s] already at target duty %.2f, waiting for new command...", config.name, dutyTarget);
+            atTarget = true;
         }
-        vTaskDelay(20 / portTICK_PERIOD_MS); // add small additional delay overall, in case the same commands get spammed
     }
-    //reset timeout when duty differs again (once)
-    else if (timeoutWaitForCommand != 0)
+    //resume periodic handling when duty differs again (once)
+    else if (atTarget)
     {
-        timeoutWaitForCommand = 0; // dont wait additional time for new commands, handle fading fast
+        atTarget = false;
         if(log) ESP_LOGI(TAG, "[%s] duty changed to %.2f, resuming at full speed", config.name, dutyTarget);
         // adjust lastRun timestamp to not mess up fading, due to much time passed but with no actual duty change
-        timestampLastRunUs = esp_timer_get_time() - 20*1000; //subtract approx 1 cycle delay
+        timestampLastRunUs = esp_timer_get_time() - usControlPeriod; //subtract 1 cycle
     }
     //TODO skip rest of the handle function below using return? Some regular driver updates sound useful though
 
 
+    //--- FLYING RESTART ---
+    //wheel is still turning (coasting) when the motor gets engaged again
+    //=> start ramp from duty matching the measured speed instead of 0 (no lag, no braking jerk)
+    #define FLYING_RESTART_MIN_SPEED_KMH 1
+    #define SPEED_DATA_MAX_AGE_US 300*1000 //speed data older than that is considered stale
+    if ((mode == motorControlMode_t::DUTY || mode == motorControlMode_t::SPEED)
+        && state != motorstate_t::BRAKE && dutyNow == 0 && dutyTarget != 0
+        && ((uint32_t)esp_timer_get_time() - snapshotThis.timeLastSpeedUpdate) < SPEED_DATA_MAX_AGE_US
+        && fabs(snapshotThis.speedKmph) >= FLYING_RESTART_MIN_SPEED_KMH
+        && (snapshotThis.speedKmph > 0) == (dutyTarget > 0)) //turning in target direction
+    {
+        dutyNow = getDutyFromSpeed(snapshotThis.speedKmph);
+        if (fabs(dutyNow) > fabs(dutyTarget)) dutyNow = dutyTarget; //dont exceed target
+        dutyRamp.reset();
+        if (mode == motorControlMode_t::SPEED) speedPid.reset(dutyNow - getDutyFromSpeed(speedTarget));
+        if(log) ESP_LOGI(TAG, "[%s] flying restart: wheel still turning with %.2fkm/h -> continue with duty=%.1f%%", config.name, snapshotThis.speedKmph, dutyNow);
+    }
+
+
+    //calculate passed time since last run
+    int64_t usPassed = esp_timer_get_time() - timestampLastRunUs;
+
+
+    //----- WHEEL SLIP OBSERVER -----
+    //evaluate wheel acceleration once per speed sensor update (used by traction control and anti-lock brake)
+    #define TCS_NO_SPEED_DATA_TIMEOUT_US 200*1000 //release limits when speed sensor did not update within that time
+    bool speedUpdated = false;
+    if (config.tractionControlSystemEnabled || config.absEnabled){
+        if (snapshotThis.timeLastSpeedUpdate != tcs_timestampLastSpeedUpdate){
+            tcs_timestampLastSpeedUpdate = snapshotThis.timeLastSpeedUpdate;
+            tcs.observe(snapshotThis.accelKmphs, snapshotThis.timeLastSpeedUpdate);
+            speedUpdated = true;
+        }
+        //speed data outdated
+        else if ((uint32_t)esp_timer_get_time() - snapshotThis.timeLastSpeedUpdate > TCS_NO_SPEED_DATA_TIMEOUT_US && tcs.isLimiting()){
+            tcs.reset();
+        }
+    }
+
+
+    //----- ANTI-LOCK BRAKE -----
+    //release brake when wheel decelerates faster than the chassis can (locking), reapply gradually
+    //applies to BRAKE state and to decelerating by reducing duty (fast brake decel or normal decel)
+    float absFactor = 1;
+    bool brakeActive = state == motorstate_t::BRAKE || fabs(dutyTarget) < fabs(dutyNow) || dutyTarget * dutyNow < 0;
+    //new brake event: dont carry reduced strength over from last event (only reapplied while braking)
+    if (brakeActive && !abs_brakeActivePrev)
+        tcs.resetBrake();
+    abs_brakeActivePrev = brakeActive;
+    if (config.absEnabled && brakeActive){
+        if (speedUpdated){
+            bool lockingPrev = tcs.isLocking();
+            tcs.updateBrake(snapshotThis.speedKmph, snapshotOther.speedKmph);
+            if (log && tcs.isLocking() && !lockingPrev)
+                ESP_LOGW("TESTING", "[%s] ABS: wheel locking - speedThis=%.2f, speedOther=%.2f, accel=%.2fkm/h/s => releasing brake (events=%d)", config.name,
+                         snapshotThis.speedKmph, snapshotOther.speedKmph, tcs.getAccel(), tcs.getAbsEventCount());
+        }
+        absFactor = tcs.getBrakeFactor(usPassed / 1000000.0);
+    }
+    abs_isActive = absFactor < 1;
+
+
 	//--- BRAKE ---
 	//brake immediately, update state, duty and exit this cycle of handle function
 	if (state == motorstate_t::BRAKE){
 		if(log) ESP_LOGD(TAG, "braking - skip fading");
-		motorSetCommand({motorstate_t::BRAKE, dutyTarget});
-		if(log) ESP_LOGD(TAG, "[%s] Set Motordriver: state=%s, duty=%.2f - Measurements: current=%.2f, speed=N/A", config.name, motorstateStr[(int)state], dutyNow, currentNow);
+		commandSend = {motorstate_t::BRAKE, dutyTarget * absFactor}; //brake strength modulated by ABS
+		commandPending = true;
+		recordTelemetry(snapshotThis.speedKmph);
 		//dutyNow = 0;
+		timestampLastRunUs = esp_timer_get_time(); //time base for ABS reapply rate in next cycle
 		return; //no need to run the fade algorithm
 	}
 
 
 	//----- FADING -----
-    //calculate passed time since last run
-    int64_t usPassed = esp_timer_get_time() - timestampLastRunUs;
 
-    //--- calculate increment (acceleration) ---
-    //calculate increment for fading UP with passed time since last run and configured fade time
-    //- traction control -
-    if (tcs_isExceeded) // disable acceleration when slippage is currently detected
-        dutyIncrementAccel = 0;
+    //--- define acceleration limits ---
+    //- traction control / current limit -
+    if (tcs_isExceeded || currentLimitActive) { // disable acceleration when slippage is currently detected or current was limited in last cycle
+        rampLimits.rateAccel = 0;
+        rampLimits.jerkAccel = 0;
+    }
     //- recent braking -
     //FIXME reset timeout when duty less
     else if (isBraking && (esp_log_timestamp() - timestampBrakeStart) < config.brakePauseBeforeResume) // prevent immediate direction change when currently braking with timeout (eventually currently sliding)
     {
         if (log) ESP_LOGI(TAG, "pause after brake... -> accel = 0");
-        dutyIncrementAccel = 0;
+        rampLimits.rateAccel = 0;
+        rampLimits.jerkAccel = 0;
     }
     //- normal accel -
-    else if (config.msFadeAccel > 0)
-        dutyIncrementAccel = (usPassed / ((float)config.msFadeAccel * 1000)) * 100; // TODO define maximum increment - first run after startup (or long) pause can cause a very large increment
-    //- sport mode -
-    else //no accel limit (immediately set to 100)
-        dutyIncrementAccel = 100;
+    //note: msFadeAccel=0 => no accel limit (sport mode)
+    else {
+        rampLimits.rateAccel = rateFromMs(config.msFadeAccel);
+        rampLimits.jerkAccel = rampGenerator::jerkFromTime(rampLimits.rateAccel, config.msJerkAccel);
+    }
 
-    //--- calculate increment (deceleration) ---
+    //--- define deceleration limits ---
     //- sport mode -
     if (config.msFadeDecel == 0){ //no decel limit (immediately reduce to 0)
-        dutyIncrementDecel = 100;
+        rampLimits.rateDecel = RAMP_UNLIMITED;
+        rampLimits.jerkDecel = 0;
     }
     //- brake -
     //detect when quicker brake response is desired (e.g. full speed forward, joystick suddenly is full reverse -> break fast)
@@ -359,13 +606,28 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
             isBraking = true;
         }
         // use brake deceleration instead of normal deceleration
-        dutyIncrementDecel = (usPassed / ((float)config.brakeDecel * 1000)) * 100;
+        rampLimits.rateDecel = rateFromMs(config.brakeDecel);
+        rampLimits.jerkDecel = rampGenerator::jerkFromTime(rampLimits.rateDecel, config.msJerkBrake);
         if(log) ESP_LOGI(TAG, "braking (target duty >%.0f%% in other direction) -> using deceleration %dms", brakeStartThreshold, config.brakeDecel);
     }
     //- normal deceleration -
     else {
         // normal deceleration according to configured time
-        dutyIncrementDecel = (usPassed / ((float)config.msFadeDecel * 1000)) * 100;
+        rampLimits.rateDecel = rateFromMs(config.msFadeDecel);
+        rampLimits.jerkDecel = rampGenerator::jerkFromTime(rampLimits.rateDecel, config.msJerkDecel);
+    }
+
+    //- anti-lock brake -
+    //decelerate slower (less brake torque) while wheel is locking
+    if (abs_isActive) {
+        rampLimits.rateDecel *= absFactor;
+    }
+
+    //- current / cascaded / speed mode -
+    //controller regulates duty directly => no fading (would slow down the control loop and cause windup)
+    if (((mode == motorControlMode_t::CURRENT || mode == motorControlMode_t::CASCADED) && currentControlActive)
+        || (mode == motorControlMode_t::SPEED && speedControlActive)) {
+        rampLimits = {RAMP_UNLIMITED, 0, RAMP_UNLIMITED, 0};
     }
 
     // reset braking state when start condition is no longer met (stick below threshold again)
@@ -376,119 +638,67 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
         isBraking = false;
     }
 
-    //--- fade duty to target (up and down) ---
-    //TODO: this needs optimization (can be more clear and/or simpler)
-    if (dutyDelta > 0) { //difference positive -> increasing duty (-100 -> 100)
-        if (dutyNow < 0) { //reverse, decelerating
-            fade(&dutyNow, dutyTarget, dutyIncrementDecel);
-        }
-        else if (dutyNow >= 0) { //forward, accelerating
-            fade(&dutyNow, dutyTarget, dutyIncrementAccel);
-        }
-    }
-    else if (dutyDelta < 0) { //difference negative -> decreasing duty (100 -> -100)
-        if (dutyNow <= 0) { //reverse, accelerating
-            fade(&dutyNow, dutyTarget, - dutyIncrementAccel);
-        }
-        else if (dutyNow > 0) { //forward, decelerating
-            fade(&dutyNow, dutyTarget, - dutyIncrementDecel);
-        }
-    }
+    //--- ramp duty to target (up and down) ---
+    //jerk limited: acceleration itself changes gradually (no jolt when starting/stopping to accelerate)
+    dutyRamp.update(&dutyNow, dutyTarget, usPassed / 1000000.0, rampLimits);
+
+
+    //----- THERMAL MODEL -----
+	//integrate heating of motor and driver (I²t), allows current above currentMax for a short time
+	currentNow = cSensor.read(&currentVoltageNow);
+	thermalMotor.update(currentNow, usPassed / 1000000.0);
+	thermalDriver.update(currentNow, usPassed / 1000000.0);
+	currentLimitNow = fminf(thermalMotor.getCurrentLimit(), thermalDriver.getCurrentLimit());
 
 
     //----- CURRENT LIMIT -----
-	currentNow = cSensor.read();
-	if ((config.currentLimitEnabled) && (dutyDelta != 0)){
-		if (fabs(currentNow) > config.currentMax){
-			float dutyOld = dutyNow;
-			//adaptive decrement:
-			//Note current exceeded twice -> twice as much decrement: TODO: decrement calc needs finetuning, currently random values
-			dutyIncrementDecel = (currentNow/config.currentMax) * ( usPassed / ((float)config.msFadeDecel * 1500) ) * 100; 
-			float currentLimitDecrement = ( (float)usPassed / ((float)1000 * 1000) ) * 100; //1000ms from 100 to 0
-			if (dutyNow < -currentLimitDecrement) {
-				dutyNow += currentLimitDecrement;
-			} else if (dutyNow > currentLimitDecrement) {
-				dutyNow -= currentLimitDecrement;
-			}
-			if(log) ESP_LOGW(TAG, "[%s] current limit exceeded! now=%.3fA max=%.1fA => decreased duty from %.3f to %.3f", config.name, currentNow, config.currentMax, dutyOld, dutyNow);
+	//limit is currentPeak while thermal budget is left, tapers to currentMax (continuous) when used up
+	//power budget: share of total power of both motors (set by task_motorctl)
+	//both are enforced every cycle, also when at target duty (e.g. sustained climb heats up the motor)
+	currentLimitActive = false;
+	bool overBudget = fabs(currentNow) > currentBudget;
+	bool overThermal = config.currentLimitEnabled && fabs(currentNow) > currentLimitNow;
+	if (overBudget || overThermal){
+		currentLimitActive = true;
+		float dutyOld = dutyNow;
+		float currentLimitDecrement = ( (float)usPassed / ((float)1000 * 1000) ) * 100; //1000ms from 100 to 0
+		if (dutyNow < -currentLimitDecrement) {
+			dutyNow += currentLimitDecrement;
+		} else if (dutyNow > currentLimitDecrement) {
+			dutyNow -= currentLimitDecrement;
 		}
+		dutyRamp.reset(); //ramp continues from limited duty
+		if(log) ESP_LOGW(TAG, "[%s] current limit exceeded! now=%.3fA max=%.1fA (thermal load=%.0f%%) budget=%.1fA => decreased duty from %.3f to %.3f", config.name, currentNow, currentLimitNow, getThermalLoad() * 100, currentBudget, dutyOld, dutyNow);
 	}
 
 
     //----- TRACTION CONTROL -----
-    //reduce duty when turning faster than expected
-    //TODO only run this when speed sensors actually updated
-    //handle tcs when enabled and new speed sensor data is available  TODO: currently assumes here that speed sensor data of other motor updated as well
-    #define TCS_MAX_ALLOWED_RATIO_DIFF 0.1 //when motor speed ratio differs more than that, one motor is slowed down
-    #define TCS_NO_SPEED_DATA_TIMEOUT_US 200*1000
-    #define TCS_MIN_SPEED_KMH 1 //must be at least that fast for TCS to be enabled
-    //TODO rework this: clearer structure (less nested if statements)
-    if (config.tractionControlSystemEnabled && mode == motorControlMode_t::SPEED && sSensor->getTimeLastUpdate() != tcs_timestampLastSpeedUpdate && (esp_timer_get_time() - tcs_timestampLastRun < TCS_NO_SPEED_DATA_TIMEOUT_US)){
-        //update last speed update received
-        tcs_timestampLastSpeedUpdate = sSensor->getTimeLastUpdate(); //TODO: re-use tcs_timestampLastRun in if statement, instead of having additional variable SpeedUpdate
-
-        //calculate time passed since last run
-        uint32_t tcs_usPassed = esp_timer_get_time() - tcs_timestampLastRun; // passed time since last time handled
-        tcs_timestampLastRun = esp_timer_get_time();
-
-        //get motor stats
-        float speedNowThis = sSensor->getKmph();
-        float speedNowOther = (*ppOtherMotor)->getCurrentSpeed();
-        float speedTargetThis = speedTarget;
-        float speedTargetOther = (*ppOtherMotor)->getTargetSpeed();
-        float dutyTargetOther = (*ppOtherMotor)->getTargetDuty();
-        float dutyTargetThis = dutyTarget;
-        float dutyNowOther = (*ppOtherMotor)->getDuty();
-        float dutyNowThis = dutyNow;
-
-
-        //calculate expected ratio
-        float ratioSpeedTarget = speedTargetThis / speedTargetOther;
-        //calculate current ratio of actual measured rotational speed
-        float ratioSpeedNow = speedNowThis / speedNowOther;
-        //calculate current duty ration (logging only)
-        float ratioDutyNow = dutyNowThis / dutyNowOther;
-
-        //calculate unexpected difference
-        float ratioDiff = ratioSpeedNow - ratioSpeedTarget;
-        if(log) ESP_LOGD("TESTING", "[%s] TCS: speedThis=%.3f, speedOther=%.3f, ratioSpeedTarget=%.3f, ratioSpeedNow=%.3f, ratioDutyNow=%.3f, diff=%.3f", config.name, speedNowThis, speedNowOther, ratioSpeedTarget, ratioSpeedNow, ratioDutyNow, ratioDiff);
-
-        //-- handle rotating faster than expected --
-        //TODO also increase duty when other motor is slipping? (diff negative)
-        if (speedNowThis < TCS_MIN_SPEED_KMH) { //disable / turn off TCS when currently too slow (danger of deadlock)
-            tcs_isExceeded = false;
-            tcs_usExceeded = 0;
-        }
-        else if (ratioDiff > TCS_MAX_ALLOWED_RATIO_DIFF ) // motor turns too fast compared to expected target ratio
-        {
-            if (!tcs_isExceeded) // just started being too fast
-            {
-                tcs_timestampBeginExceeded = esp_timer_get_time();
-                tcs_isExceeded = true; //also blocks further acceleration (fade)
-                if(log) ESP_LOGW("TESTING", "[%s] TCS: now exceeding max allowed ratio diff! diff=%.2f max=%.2f", config.name, ratioDiff, TCS_MAX_ALLOWED_RATIO_DIFF);
-            }
-            else
-            { // too fast for more than 2 cycles already
-                tcs_usExceeded = esp_timer_get_time() - tcs_timestampBeginExceeded; //time too fast already
-                if(log) ESP_LOGI("TESTING", "[%s] TCS: faster than expected since %dms, current ratioDiff=%.2f  -> slowing down", config.name, tcs_usExceeded/1000, ratioDiff);
-                // calculate amount duty gets decreased
-                float dutyDecrement = (tcs_usPassed / ((float)config.msFadeDecel * 1000)) * 100; //TODO optimize dynamic increment: P:scale with ratio-difference, I: scale with duration exceeded
-                // decrease duty
-                if(log) ESP_LOGI("TESTING", "[%s] TCS: msPassed=%.3f, reducing duty by %.3f%%", config.name, (float)tcs_usPassed/1000, dutyDecrement);
-                fade(&dutyNow, 0, -dutyDecrement); //reduce duty but not less than 0
-            }
-        }
-        else
-        { // not exceeded
-            tcs_isExceeded = false;
-            tcs_usExceeded = 0;
+    //limit duty when the wheel is slipping (see tractioncontrol.hpp), restore torque gradually once grip returns
+    //slip is evaluated once per speed sensor update, limit is applied every cycle (all control modes)
+    if (config.tractionControlSystemEnabled){
+        //new speed data available
+        if (speedUpdated){
+            bool slippingPrev = tcs.isSlipping();
+            tcs.update(snapshotThis.speedKmph, snapshotOther.speedKmph, dutyNow, snapshotOther.dutyNow, currentNow,
+                       snapshotThis.speedAtFullDutyKmh, snapshotOther.speedAtFullDutyKmh);
+            if (log && tcs.isSlipping() != slippingPrev)
+                ESP_LOGW("TESTING", "[%s] TCS: %s - speedThis=%.2f, speedOther=%.2f, accel=%.2fkm/h/s, current=%.1fA => duty limit %.1f%%", config.name,
+                         tcs.isSlipping() ? "slip detected" : "grip returned", snapshotThis.speedKmph, snapshotOther.speedKmph, tcs.getAccel(), currentNow, tcs.getDutyLimit());
         }
+        //apply limit
+        float dutyUnlimited = dutyNow;
+        dutyNow = tcs.limitDuty(dutyNow, usPassed / 1000000.0);
+        if (dutyNow != dutyUnlimited) dutyRamp.reset(); //ramp continues from limited duty
+        tcs_isExceeded = tcs.isSlipping(); //also blocks further acceleration (fade)
     }
-    else // TCS mode not active or timed out
-    {    // not exceeded
-        tcs_isExceeded = false;
-        tcs_usExceeded = 0;
-        }
+    else tcs_isExceeded = false;
+
+
+    //--- SPEED CONTROL ANTI-WINDUP ---
+    //duty may have been reduced by current limit, power budget or traction control
+    //=> integral of speed controller follows the duty actually applied (back-calculation)
+    if (mode == motorControlMode_t::SPEED && speedControlActive)
+        speedPid.trackOutput(dutyNow);
 
 	
 
@@ -497,34 +707,102 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
 	state=getStateFromDuty(dutyNow);
 
 
+	//--- SPEED SENSOR PLAUSIBILITY ---
+	//no edges for a long time while driving with considerable duty => sensor missing or failed (or wheel blocked)
+	//recovers with the next edge
+	#define SPEED_SENSOR_FAIL_MIN_DUTY 30
+	#define SPEED_SENSOR_FAIL_TIMEOUT_US 2000*1000
+	bool speedDataRecent = ((uint32_t)esp_timer_get_time() - snapshotThis.timeLastSpeedUpdate) < SPEED_DATA_MAX_AGE_US;
+	if (speedDataRecent) {
+		if (speedSensorFailed && log) ESP_LOGW(TAG, "[%s] speed sensor delivers pulses again", config.name);
+		speedSensorFailed = false;
+	}
+	if (speedDataRecent || fabs(dutyNow) < SPEED_SENSOR_FAIL_MIN_DUTY)
+		timestamp_speedSensorPlausible = esp_timer_get_time();
+	else if (!speedSensorFailed && esp_timer_get_time() - timestamp_speedSensorPlausible > SPEED_SENSOR_FAIL_TIMEOUT_US) {
+		speedSensorFailed = true;
+		if(log) ESP_LOGE(TAG, "[%s] no speed sensor pulses while driving with duty=%.1f%% => sensor failed?", config.name, dutyNow);
+	}
+
+
 	//--- DEAD TIME ----
-	//ensure minimum idle time between direction change to prevent driver overload
+	//ensure the wheel stopped before direction change to prevent driver overload
 	//FWD -> IDLE -> FWD  continue without waiting
-	//FWD -> IDLE -> REV  wait for dead-time in IDLE
+	//FWD -> IDLE -> REV  wait in IDLE until wheel (nearly) stopped
+	//speed known: reverse as soon as estimated speed is below threshold (or already in new direction)
+	//  note: without edges the observer bounds the speed by time since last edge => decays to 0 when wheel stopped
+	//speed unknown (no edge since boot or sensor failed) => fall back to fixed dead-time (deadTimeMs)
 	//TODO check when changed only?
-    if (config.deadTimeMs > 0) { //deadTime is enabled
-	    if (	//not enough time between last direction state
-	    		(   state == motorstate_t::FWD && (esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::REV] < config.deadTimeMs))
-	    		|| (state == motorstate_t::REV && (esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::FWD] < config.deadTimeMs))
-	       ){
+	#define DEAD_TIME_SPEED_MAX_WAIT_MS 2000 //reverse anyways when wheel did not slow down within that time (e.g. rolling downhill)
+    if (config.deadTimeMs > 0 || config.deadTimeMaxSpeedKmh > 0) { //deadTime is enabled
+	    //time since other direction was last active
+	    uint32_t msSinceOtherDirection = UINT32_MAX;
+	    if (state == motorstate_t::FWD) msSinceOtherDirection = esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::REV];
+	    else if (state == motorstate_t::REV) msSinceOtherDirection = esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::FWD];
+	    //wheel stopped according to speed sensor
+	    bool speedKnown = !speedSensorFailed && snapshotThis.timeLastSpeedUpdate != 0;
+	    bool wheelStopped = speedKnown &&
+	    		(fabs(snapshotThis.speedKmph) <= config.deadTimeMaxSpeedKmh || (snapshotThis.speedKmph > 0) == (state == motorstate_t::FWD));
+	    //not stopped yet / not enough time between last direction state
+	    bool waitRequired = speedKnown ? (!wheelStopped && msSinceOtherDirection < DEAD_TIME_SPEED_MAX_WAIT_MS)
+	                                   : (msSinceOtherDirection < config.deadTimeMs);
+	    if (waitRequired){
 	    	if(log) ESP_LOGD(TAG, "waiting dead-time... dir change %s -> %s", motorstateStr[(int)statePrev], motorstateStr[(int)state]);
 	    	if (!deadTimeWaiting){ //log start
 	    		deadTimeWaiting = true;
-	    		if(log) ESP_LOGI(TAG, "starting dead-time... %s -> %s", motorstateStr[(int)statePrev], motorstateStr[(int)state]);
+	    		if(log) ESP_LOGI(TAG, "starting dead-time... %s -> %s (speed=%.2f, %s)", motorstateStr[(int)statePrev], motorstateStr[(int)state],
+	    				snapshotThis.speedKmph, speedKnown ? "wait for stop" : "speed unknown, fixed time");
 	    	}
 	    	//force IDLE state during wait
 	    	state = motorstate_t::IDLE;
 	    	dutyNow = 0;
+	    	dutyRamp.reset(); //start in new direction with jerk phase (rate would build up while held at 0)
 	    } else {
 	    	if (deadTimeWaiting){ //log end
 	    		deadTimeWaiting = false;
-	    		if(log) ESP_LOGI(TAG, "dead-time ended - continue with %s", motorstateStr[(int)state]);
+	    		if(log) ESP_LOGI(TAG, "dead-time ended after %dms - continue with %s", msSinceOtherDirection, motorstateStr[(int)state]);
 	    	}
 	    	if(log) ESP_LOGV(TAG, "deadtime: no change below deadtime detected... dir=%s, duty=%.1f", motorstateStr[(int)state], dutyNow);
 	    }
     }
 			
 
+	//--- LEARN DUTY-SPEED RELATION ---
+	//when running at constant duty for some time, the measured speed is added to the duty-speed map (binned by battery voltage)
+	//note: duty changes only slowly in SPEED mode too (steady state), map is used as feedforward and for flying restart
+	#define LEARN_STEADY_MS 500    //duty has to be constant (within tolerance) that long
+	#define LEARN_DUTY_TOLERANCE 1 //duty change below that still counts as constant
+	#define LEARN_INTERVAL_MS 100  //time between samples (consecutive cycles are not independent)
+	if (fabs(dutyNow - learn_dutyPrev) > LEARN_DUTY_TOLERANCE) {
+		learn_dutyPrev = dutyNow;
+		learn_timestampDutyChanged = esp_log_timestamp();
+	}
+	else if (esp_log_timestamp() - learn_timestampDutyChanged > LEARN_STEADY_MS
+			 && esp_log_timestamp() - learn_timestampLastSample > LEARN_INTERVAL_MS
+			 && batteryVoltage > 0 && !tcs_isExceeded && !abs_isActive && !deadTimeWaiting
+			 && ((uint32_t)esp_timer_get_time() - snapshotThis.timeLastSpeedUpdate) < SPEED_DATA_MAX_AGE_US) {
+		learn_timestampLastSample = esp_log_timestamp();
+		dsMap.learn(dutyNow, snapshotThis.speedKmph, batteryVoltage);
+	}
+
+
+	//--- ZERO CURRENT TRACKING ---
+	//zero point of the current sensor drifts with temperature
+	//=> while motor is off and wheel stopped for some time, the voltage already read this cycle is used to track the zero point
+	#define ZERO_TRACK_IDLE_DELAY_MS 2000  //time since motor was last on (current decayed completely)
+	#define ZERO_TRACK_INTERVAL_MS 500     //time between samples
+	#define ZERO_TRACK_MAX_SPEED_KMH 0.5   //wheel turning generates current
+	if (dutyNow == 0 && dutyTarget == 0 && state != motorstate_t::BRAKE
+		&& esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::FWD] > ZERO_TRACK_IDLE_DELAY_MS
+		&& esp_log_timestamp() - timestampsModeLastActive[(int)motorstate_t::REV] > ZERO_TRACK_IDLE_DELAY_MS
+		&& esp_log_timestamp() - timestamp_zeroTrackLastSample > ZERO_TRACK_INTERVAL_MS
+		&& (((uint32_t)esp_timer_get_time() - snapshotThis.timeLastSpeedUpdate) > SPEED_DATA_MAX_AGE_US //no pulses => stopped
+			|| fabs(snapshotThis.speedKmph) < ZERO_TRACK_MAX_SPEED_KMH)) {
+		timestamp_zeroTrackLastSample = esp_log_timestamp();
+		cSensor.trackZero(currentVoltageNow);
+	}
+
+
 	//--- save current actual motorstate and timestamp ---
 	//needed for deadtime
 	timestampsModeLastActive[(int)getStateFromDuty(dutyNow)] = esp_log_timestamp();
@@ -532,11 +810,12 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
 	statePrev = getStateFromDuty(dutyNow);
 
 
-    //--- apply new target to motor ---
-    motorSetCommand({state, (float)fabs(dutyNow)});
-	if(log) ESP_LOGI(TAG, "[%s] Set Motordriver: state=%s, duty=%.2f - Measurements: current=%.2f, speed=N/A", config.name, motorstateStr[(int)state], dutyNow, currentNow);
-    //note: BRAKE state is handled earlier
-    
+    //--- define new target for motor ---
+    //note: applied by applyCommand(), BRAKE state is handled earlier
+    commandSend = {state, (float)fabs(dutyNow)};
+    commandPending = true;
+    recordTelemetry(snapshotThis.speedKmph);
+
 
     //--- update timestamp ---
     timestampLastRunUs = esp_timer_get_time(); //update timestamp last run with current timestamp in microseconds
@@ -544,6 +823,155 @@ if ( dutyNow != 0 && esp_log_timestamp() - timestamp_commandReceived > TIMEOUT_I
 
 
 
+//==============================
+//======== applyCommand ========
+//==============================
+//send command calculated in last handle() cycle to the motor driver
+//note: run for both motors right after handle() of both motors => driver updates of left and right are not skewed
+void controlledMotor::applyCommand(){
+    if (!commandPending) return; //cycle was skipped
+    motorSetCommand(commandSend);
+    commandPending = false;
+    //note: state of each cycle is recorded in telemetry buffer (see recordTelemetry), no logging here
+}
+
+
+
+//=================================
+//======== recordTelemetry ========
+//=================================
+//write compact record of this control cycle to the lock-free telemetry buffer
+//note: only integer conversion here, formatting/output is done by the low priority task_telemetry
+static inline int16_t toFixed(float value){
+    float scaled = value * 100;
+    if (scaled > INT16_MAX) return INT16_MAX;
+    if (scaled < INT16_MIN) return INT16_MIN;
+    return (int16_t)scaled;
+}
+void controlledMotor::recordTelemetry(float speedKmph){
+    motorTelemetry_t record = {};
+    record.timestampUs = (uint32_t)esp_timer_get_time();
+    record.dutyTarget = toFixed(dutyTarget);
+    record.dutyNow = toFixed(dutyNow);
+    record.current = toFixed(currentNow);
+    record.speed = toFixed(speedKmph);
+    record.state = (uint8_t)commandSend.state;
+    record.flags = (isBraking ? TELEMETRY_FLAG_BRAKING : 0)
+                 | (tcs_isExceeded ? TELEMETRY_FLAG_TCS : 0)
+                 | (currentLimitActive ? TELEMETRY_FLAG_CURRENT_LIMIT : 0)
+                 | (deadTimeWaiting ? TELEMETRY_FLAG_DEADTIME : 0)
+                 | (receiveTimeout ? TELEMETRY_FLAG_TIMEOUT : 0)
+                 | (abs_isActive ? TELEMETRY_FLAG_ABS : 0);
+    record.absEvents = (uint16_t)tcs.getAbsEventCount();
+    telemetry.push(record);
+}
+
+
+
+//==============================
+//===== persistLearnedData =====
+//==============================
+//write learned duty-speed map and odometer of the speed sensor to nvs when changed (limited write frequency)
+//note: called by task_motorctl only while both motors are stopped (flash write would stall the control loop while driving)
+#define DSMAP_NVS_WRITE_INTERVAL_MS 120000 //write changed map to nvs at most that often
+void controlledMotor::persistLearnedData(){
+	if (dsMap.isChanged() && esp_log_timestamp() - timestamp_dsMapLastWrite > DSMAP_NVS_WRITE_INTERVAL_MS) {
+		timestamp_dsMapLastWrite = esp_log_timestamp();
+		writeDutySpeedMap();
+	}
+	//write frequency is limited by speedSensor
+	sSensor->saveOdometer();
+}
+
+
+
+//==============================
+//====== getDutyFromSpeed ======
+//==============================
+//estimate duty at which the motor runs at the provided speed
+//=> duty that compensates back-emf, used as feedforward by closed-loop control modes and for flying restart
+//note: uses duty-speed map learned while driving (config.speedAtFullDutyKmh until learned)
+float controlledMotor::getDutyFromSpeed(float speedKmph){
+    //battery voltage not known yet => use middle of range
+    float voltage = batteryVoltage > 0 ? batteryVoltage : (config.dsMapVoltageMin + config.dsMapVoltageMax) / 2;
+    return dsMap.getDuty(speedKmph, voltage);
+}
+
+//speed the motor would reach at 100% duty in the range of the provided duty (learned duty-speed map)
+//=> slope of the duty-speed relation, used by traction control
+float controlledMotor::getSpeedAtFullDuty(float duty){
+    float voltage = batteryVoltage > 0 ? batteryVoltage : (config.dsMapVoltageMin + config.dsMapVoltageMax) / 2;
+    return dsMap.getSpeedAtFullDuty(duty, voltage);
+}
+
+
+
+//===============================
+//====== runCurrentControl ======
+//===============================
+//regulate to provided target current using pi controller with back-emf feedforward, updates dutyTarget
+//used by CURRENT mode and as inner loop of CASCADED mode
+//note: only runs with configured rate (current measurement is expensive, limits bandwidth for stable control), keeps previous target otherwise
+#define CURRENT_CONTROL_MAX_DT_S 0.1 //limit time passed used for pi calculation (e.g. first run after skipped cycles)
+void controlledMotor::runCurrentControl(float ampereTarget, bool reverse, float speedKmph){
+    if (currentControlActive && esp_timer_get_time() - timestamp_currentControlLastRun < config.currentControlPeriodMs * 1000)
+        return;
+    float dtSeconds = (esp_timer_get_time() - timestamp_currentControlLastRun) / 1000000.0;
+    if (dtSeconds > CURRENT_CONTROL_MAX_DT_S) dtSeconds = CURRENT_CONTROL_MAX_DT_S;
+    timestamp_currentControlLastRun = esp_timer_get_time();
+
+    float ampereNow = cSensor.read();
+
+    //feedforward: duty that compensates back-emf at current speed (=> 0A), controller only adds part needed for target current
+    float dutyFeedforward = getDutyFromSpeed(speedKmph);
+
+    //limit output to direction of command (dont actively drive in other direction)
+    if (reverse)
+        currentPid.setOutputLimits(-100, 0);
+    else
+        currentPid.setOutputLimits(0, 100);
+
+    //start from current duty when controller was inactive (no jump)
+    if (!currentControlActive) {
+        currentPid.reset(dutyNow - dutyFeedforward);
+        currentControlActive = true;
+    }
+
+    dutyTarget = currentPid.update(ampereTarget, ampereNow, dtSeconds, dutyFeedforward);
+    if(log) ESP_LOGV("TESTING", "[%s] CURRENT-CONTROL: ampereNow=%.2f, ampereTarget=%.2f, feedforward=%.1f%% => duty-target=%.1f%% (saturated=%d)",
+                     config.name, ampereNow, ampereTarget, dutyFeedforward, dutyTarget, currentPid.isSaturated());
+}
+
+
+
+//===============================
+//====== recordLoopTiming =======
+//===============================
+//update overrun and jitter statistics of the fixed-rate control loop (called by task_motorctl after each cycle)
+//usInterval: time between this and previous wakeup, usExecution: duration of handle()
+void controlledMotor::recordLoopTiming(int64_t usInterval, int64_t usExecution, uint32_t ticksMissed){
+    loopStats.cycleCount++;
+    // jitter
+    uint32_t jitter = llabs(usInterval - (int64_t)usControlPeriod);
+    if (jitter > loopStats.jitterMaxUs)
+        loopStats.jitterMaxUs = jitter;
+    loopStats.jitterAvgUs += ((float)jitter - loopStats.jitterAvgUs) * 0.01;
+    // overrun
+    if (usExecution > usControlPeriod || ticksMissed > 0)
+    {
+        loopStats.overrunCount++;
+        loopStats.ticksMissed += ticksMissed;
+        if (log) ESP_LOGD(TAG, "[%s] control loop overrun: execution=%lldus, period=%dus, missedTicks=%d (total overruns=%d)",
+                          config.name, usExecution, usControlPeriod, ticksMissed, loopStats.overrunCount);
+    }
+    // log statistics once in a while
+    if (log && loopStats.cycleCount % 5000 == 0)
+        ESP_LOGI(TAG, "[%s] control loop stats: cycles=%d, overruns=%d, missedTicks=%d, jitterAvg=%.1fus, jitterMax=%dus",
+                 config.name, loopStats.cycleCount, loopStats.overrunCount, loopStats.ticksMissed, loopStats.jitterAvgUs, loopStats.jitterMaxUs);
+}
+
+
+
 //===============================
 //========== setTarget ==========
 //===============================
@@ -553,6 +981,9 @@ void controlledMotor::setTarget(motorCommand_t commandSend){
     if(log) ESP_LOGI(TAG, "[%s] setTarget: Inserting command to queue: state='%s'(%d), duty=%.2f", config.name, motorstateStr[(int)commandSend.state], (int)commandSend.state, commandSend.duty);
     //send command to queue (overwrite if an old command is still in the queue and not processed)
     xQueueOverwrite( commandQueue, ( void * )&commandSend);
+    //wake motorctl task => command is processed immediately instead of with next tick
+    if (controlTask != NULL)
+        xTaskNotify(controlTask, MOTORCTL_NOTIFY_COMMAND, eSetBits);
     //xQueueSend( commandQueue, ( void * )&commandSend, ( TickType_t ) 0 );
     if(log) ESP_LOGD(TAG, "finished inserting new command");
 }
@@ -776,6 +1207,34 @@ void controlledMotor::writeAccelDuration(uint32_t newValue)
     config.msFadeAccel = newValue;
 }
 
+//-----------------------------
+//--- loadSpeedControlGains ---
+//-----------------------------
+// load stored gains of speed controller from nvs, if not successfull keeps config default values
+void controlledMotor::loadSpeedControlGains(void)
+{
+    // read from nvs
+    pidGains_t gainsNew;
+    size_t size = sizeof(pidGains_t);
+    char key[15];
+    snprintf(key, 15, "m-%s-spdPid", config.name);
+    esp_err_t err = nvs_get_blob(*nvsHandle, key, &gainsNew, &size);
+    switch (err)
+    {
+    case ESP_OK:
+        ESP_LOGW(TAG, "Successfully read value '%s' from nvs. Overriding default speed-control gains with kp=%.3f ki=%.3f kd=%.3f", key, gainsNew.kp, gainsNew.ki, gainsNew.kd);
+        speedPid.setGains(gainsNew);
+        break;
+    case ESP_ERR_NVS_NOT_FOUND:
+        ESP_LOGW(TAG, "nvs: the value '%s' is not initialized yet, keeping default gains", key);
+        break;
+    default:
+        ESP_LOGE(TAG, "Error (%s) reading nvs!", esp_err_to_name(err));
+    }
+}
+
+
+
 //------------------------------
 //----- writeDecelDuration -----
 //------------------------------
@@ -803,4 +1262,97 @@ void controlledMotor::writeDecelDuration(uint32_t newValue)
         ESP_LOGI(TAG, "nvs: successfully committed updates");
     // update variable
     config.msFadeDecel = newValue;
-}
\ No newline at end of file
+}
+
+
+
+//---------------------------------
+//---- writeSpeedControlGains -----
+//---------------------------------
+// write provided gains to nvs to be persistent and update the speed controller
+void controlledMotor::writeSpeedControlGains(pidGains_t gainsNew)
+{
+    // generate nvs storage key
+    char key[15];
+    snprintf(key, 15, "m-%s-spdPid", config.name);
+    // update nvs value
+    ESP_LOGW(TAG, "[%s] updating nvs value '%s' to kp=%.3f ki=%.3f kd=%.3f", config.name, key, gainsNew.kp, gainsNew.ki, gainsNew.kd);
+    esp_err_t err = nvs_set_blob(*nvsHandle, key, &gainsNew, sizeof(pidGains_t));
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "nvs: failed writing");
+    err = nvs_commit(*nvsHandle);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "nvs: failed committing updates");
+    else
+        ESP_LOGI(TAG, "nvs: successfully committed updates");
+    // update controller
+    speedPid.setGains(gainsNew);
+}
+
+
+
+//=================================
+//===== setSpeedControlGains ======
+//=================================
+//set gains of the speed controller (SPEED mode) and write them to nvs by default
+void controlledMotor::setSpeedControlGains(pidGains_t gains, bool writeToNvs){
+    ESP_LOGW(TAG, "[%s] changed speed-control gains to kp=%.3f ki=%.3f kd=%.3f", config.name, gains.kp, gains.ki, gains.kd);
+    if (writeToNvs)
+        writeSpeedControlGains(gains);
+    else
+        speedPid.setGains(gains);
+}
+
+
+
+//-----------------------------
+//----- loadDutySpeedMap ------
+//-----------------------------
+// load learned duty-speed map from nvs, if not successfull starts with config default (speedAtFullDutyKmh)
+void controlledMotor::loadDutySpeedMap(void)
+{
+    // read from nvs
+    dutySpeedMap_data_t dataNew;
+    size_t size = sizeof(dutySpeedMap_data_t);
+    char key[15];
+    snprintf(key, 15, "m-%s-dsMap", config.name);
+    esp_err_t err = nvs_get_blob(*nvsHandle, key, &dataNew, &size);
+    switch (err)
+    {
+    case ESP_OK:
+        if (size == sizeof(dutySpeedMap_data_t) && dsMap.setData(dataNew))
+            ESP_LOGW(TAG, "Successfully read value '%s' from nvs. Using learned duty-speed map with %d samples", key, dsMap.getSampleCount());
+        else
+            ESP_LOGW(TAG, "nvs: stored duty-speed map '%s' has different layout, starting with default", key);
+        break;
+    case ESP_ERR_NVS_NOT_FOUND:
+        ESP_LOGW(TAG, "nvs: the value '%s' is not initialized yet, starting with default duty-speed map", key);
+        break;
+    default:
+        ESP_LOGE(TAG, "Error (%s) reading nvs!", esp_err_to_name(err));
+    }
+}
+
+
+
+//------------------------------
+//----- writeDutySpeedMap ------
+//------------------------------
+// write learned duty-speed map to nvs to be persistent
+void controlledMotor::writeDutySpeedMap(void)
+{
+    // generate nvs storage key
+    char key[15];
+    snprintf(key, 15, "m-%s-dsMap", config.name);
+    // update nvs value
+    ESP_LOGW(TAG, "[%s] updating nvs value '%s' (learned duty-speed map, %d samples)", config.name, key, dsMap.getSampleCount());
+    esp_err_t err = nvs_set_blob(*nvsHandle, key, dsMap.getData(), sizeof(dutySpeedMap_data_t));
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "nvs: failed writing");
+    err = nvs_commit(*nvsHandle);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "nvs: failed committing updates");
+    else
+        ESP_LOGI(TAG, "nvs: successfully committed updates");
+    dsMap.clearChanged();
+}
@@ -14,6 +14,12 @@ extern "C"
 #include "motordrivers.hpp"
 #include "currentsensor.hpp"
 #include "speedsensor.hpp"
+#include "pid.hpp"
+#include "ramp.hpp"
+#include "telemetry.hpp"
+#include "tractioncontrol.hpp"
+#include "dutyspeedmap.hpp"
+#include "thermalmodel.hpp"
 
 
 //=======================================
@@ -24,7 +30,28 @@ extern "C"
 
 typedef void (*motorSetCommandFunc_t)(motorCommand_t cmd);
 
-enum class motorControlMode_t {DUTY, CURRENT, SPEED};
+enum class motorControlMode_t {DUTY, CURRENT, SPEED, CASCADED}; //CASCADED: speed loop defines target current of current loop
+
+//struct with timing statistics of the fixed-rate control loop (recorded by task_motorctl)
+typedef struct motorctl_loopStats_t {
+    uint32_t cycleCount;    //count of evaluated control cycles
+    uint32_t overrunCount;  //cycles where handle() took longer than one period or ticks were missed
+    uint32_t ticksMissed;   //total count of timer ticks that could not be handled in time
+    uint32_t jitterMaxUs;   //largest deviation of the wakeup interval from the configured period
+    float jitterAvgUs;      //moving average of that deviation
+} motorctl_loopStats_t;
+
+//struct with state of one motor, taken once per control cycle for both motors
+//=> both motors evaluate the same consistent data (e.g. traction control compares this with other motor)
+typedef struct motorSnapshot_t {
+    float speedKmph;
+    float accelKmphs; //estimated by speed sensor observer (km/h per second)
+    uint32_t timeLastSpeedUpdate;
+    float speedTarget;
+    float dutyTarget;
+    float dutyNow;
+    float speedAtFullDutyKmh; //learned duty-speed relation at current duty and battery voltage
+} motorSnapshot_t;
 
 //===================================
 //====== controlledMotor class ======
@@ -33,8 +60,10 @@ class controlledMotor {
     public:
         //--- functions ---
         //TODO move speedsensor object creation in this class to (pass through / wrap methods)
-        controlledMotor(motorSetCommandFunc_t setCommandFunc,  motorctl_config_t config_control, nvs_handle_t * nvsHandle, speedSensor * speedSensor, controlledMotor ** otherMotor); //constructor with structs for configuring motordriver and parameters for control TODO: add configuration for currentsensor
-        void handle(); //controls motor duty with fade and current limiting feature (has to be run frequently by another task)
+        controlledMotor(motorSetCommandFunc_t setCommandFunc,  motorctl_config_t config_control, nvs_handle_t * nvsHandle, speedSensor * speedSensor); //constructor with structs for configuring motordriver and parameters for control TODO: add configuration for currentsensor
+        motorSnapshot_t getSnapshot(); //get current state (speed, duty) of this motor, passed to handle() of both motors
+        void handle(const motorSnapshot_t &snapshotThis, const motorSnapshot_t &snapshotOther); //calculates new motor duty with fade and current limiting feature (has to be run frequently by another task)
+        void applyCommand(); //apply command calculated by handle() to motordriver (if there is a new one)
         void setTarget(motorstate_t state_f, float duty_f = 0); //adds target command to queue for handle function
         void setTarget(motorCommand_t command); 
         motorCommand_t getStatus(); //get current status of the motor (returns struct with state and duty)
@@ -43,9 +72,16 @@ class controlledMotor {
         float getTargetSpeed() {return speedTarget;};
         float getCurrentSpeed() {return sSensor->getKmph();};
         void enableTractionControlSystem() {config.tractionControlSystemEnabled = true;};
-        void disableTractionControlSystem() {config.tractionControlSystemEnabled = false; tcs_isExceeded = false;};
+        void disableTractionControlSystem() {config.tractionControlSystemEnabled = false; tcs_isExceeded = false; tcs.reset();};
         bool getTractionControlSystemStatus() {return config.tractionControlSystemEnabled;};
-        void setControlMode(motorControlMode_t newMode) {mode = newMode;};
+        uint32_t getAbsEventCount() {return tcs.getAbsEventCount();}; //count of wheel locking events detected by anti-lock brake
+        float getDutyFromSpeed(float speedKmph); // feedforward: duty at which motor runs at that speed (learned duty-speed map)
+        float getSpeedAtFullDuty(float duty); // learned speed at 100% duty in range of that duty (duty-speed map)
+        dutySpeedMap * getDutySpeedMap() {return &dsMap;};
+        void setBatteryVoltage(float voltage) {batteryVoltage = voltage;}; //update battery voltage used for duty-speed map and power budget (set periodically by task_motorctl)
+        bool isStopped() {return dutyNow == 0 && dutyTarget == 0;};
+        void persistLearnedData(); //write changed learned data and odometer to nvs (only while both motors are stopped, stalls flash access)
+        void setControlMode(motorControlMode_t newMode) {mode = newMode; speedControlActive = false; currentControlActive = false; cascadeActive = false;};
         void setBrakeStartThresholdDuty(float duty) {brakeStartThreshold = duty;};
         void setBrakeDecel(uint32_t msFadeBrake) {config.brakeDecel = msFadeBrake;};
         uint32_t getBrakeDecel() {return config.brakeDecel;}; //todo store and load from nvs
@@ -57,8 +93,26 @@ class controlledMotor {
         void setFade(fadeType_t fadeType, uint32_t msFadeNew, bool writeToNvs = true); //set acceleration or deceleration fade time and write it to nvs by default
         bool toggleFade(fadeType_t fadeType); //toggle acceleration or deceleration on/off
 
+        pidGains_t getSpeedControlGains() {return speedPid.getGains();}; //get gains of speed controller (SPEED mode)
+        void setSpeedControlGains(pidGains_t gains, bool writeToNvs = true); //set gains of speed controller and write them to nvs by default
+
         float getCurrentA() {return cSensor.read();}; //read current-sensor of this motor (Ampere)
+        float getThermalLoad() {return fmaxf(thermalMotor.getLoad(), thermalDriver.getLoad());}; //used thermal budget of motor or driver (0 = cold, 1 = at continuous limit)
+        float getCurrentLimitNow() {return currentLimitNow;}; //current currently allowed by thermal model (motor or driver, power budget not included)
+        float getCurrentLastCycle() {return currentNow;}; //current measured in last handle() (no additional adc read)
+        float getBatteryVoltage() {return batteryVoltage;};
+        void setCurrentBudget(float ampere) {currentBudget = ampere;}; //share of total power budget (set by task_motorctl every cycle), INFINITY = no budget
+        float getCurrentBudget() {return currentBudget;};
         char * getName() const {return config.name;};
+
+        //--- fixed-rate control loop ---
+        void setControlPeriod(uint32_t usPeriod) {usControlPeriod = usPeriod;}; //period handle() is run with (set by task_motorctl)
+        uint32_t getControlPeriod() {return usControlPeriod;};
+        void setControlTask(TaskHandle_t task) {controlTask = task;}; //task that gets notified by setTarget (set by task_motorctl)
+        bool needsTick() {return !atTarget;}; //false when nothing changes without a new command => no periodic handling required
+        void recordLoopTiming(int64_t usInterval, int64_t usExecution, uint32_t ticksMissed); //update overrun and jitter statistics
+        motorctl_loopStats_t getLoopStats() {return loopStats;};
+        motorTelemetryBuffer_t * getTelemetryBuffer() {return &telemetry;}; //records of every control cycle (drained by task_telemetry)
 											  
 		//TODO set current limit method
 
@@ -69,6 +123,12 @@ class controlledMotor {
         void loadDecelDuration(void);
         void writeAccelDuration(uint32_t newValue); // write value to nvs and update local variable
         void writeDecelDuration(uint32_t newValue);
+        void loadSpeedControlGains(void); // load stored gains for speed controller from nvs
+        void writeSpeedControlGains(pidGains_t gainsNew);
+        void loadDutySpeedMap(void); // load learned duty-speed map from nvs
+        void writeDutySpeedMap(void);
+        void runCurrentControl(float ampereTarget, bool reverse, float speedKmph); // update dutyTarget using current controller (limited rate)
+        void recordTelemetry(float speedKmph); // write record of this cycle to telemetry buffer
 
         //--- objects ---
         //queue for sending commands to the separate task running the handle() function very fast
@@ -77,9 +137,6 @@ class controlledMotor {
 		currentSensor cSensor;
         //speed sensor
         speedSensor * sSensor;
-        //other motor (needed for traction control)
-        controlledMotor ** ppOtherMotor; //ptr to ptr of controlledMotor (because not created at initialization yet)
-
 
 		//function pointer that sets motor duty (driver)
 		motorSetCommandFunc_t motorSetCommand;
@@ -97,40 +154,78 @@ class controlledMotor {
 
         float currentMax;
         float currentNow;
+        float currentVoltageNow = 0; //sensor voltage sampled with currentNow (zero tracking)
+        bool currentLimitActive = false;
+        float currentLimitNow = 0;
+        float currentBudget = INFINITY;
 
         //speed mode
         float speedTarget = 0;
         float speedNow = 0;
-        uint32_t timestamp_speedLastUpdate = 0;
+        pidController speedPid;
+        bool speedControlActive = false;
+
+        //current mode
+        pidController currentPid;
+        bool currentControlActive = false;
+        int64_t timestamp_currentControlLastRun = 0;
+
+        //cascaded mode (outer speed loop => inner current loop)
+        pidController cascadeSpeedPid;
+        bool cascadeActive = false;
+        float cascadeAmpereTarget = 0;
+        int64_t timestamp_cascadeLastRun = 0;
 
 
         float dutyTarget = 0;
         float dutyNow = 0;
 
-        float dutyIncrementAccel;
-        float dutyIncrementDecel;
+        //learned duty-speed relation (flying restart, feedforward)
+        dutySpeedMap dsMap;
+        float batteryVoltage = 0; //0 = unknown
+        float learn_dutyPrev = 0;
+        uint32_t learn_timestampDutyChanged = 0;
+        uint32_t learn_timestampLastSample = 0;
+        uint32_t timestamp_dsMapLastWrite = 0;
+
+        rampGenerator dutyRamp; //jerk limited ramp for dutyNow
+        rampLimits_t rampLimits;
         float dutyDelta;
-        uint32_t timeoutWaitForCommand = 0;
+        bool atTarget = false; //nothing to do until a new command arrives (see DETECT ALREADY AT TARGET)
 
         uint32_t ramp;
         int64_t timestampLastRunUs = 0;
 
+        //fixed-rate control loop
+        uint32_t usControlPeriod = 10000;
+        TaskHandle_t controlTask = NULL;
+        motorctl_loopStats_t loopStats = {};
+        motorTelemetryBuffer_t telemetry;
+
 		bool deadTimeWaiting = false;
+		bool speedSensorFailed = false; //no edges while driving (speed unknown, dead time falls back to fixed time)
+		int64_t timestamp_speedSensorPlausible = 0;
 		uint32_t timestampsModeLastActive[4] = {};
+		uint32_t timestamp_zeroTrackLastSample = 0;
         motorstate_t statePrev = motorstate_t::FWD;
 
         struct motorCommand_t commandReceive = {};
-        struct motorCommand_t commandSend = {};
+        struct motorCommand_t commandSend = {}; //command calculated by handle(), applied by applyCommand()
+        bool commandPending = false;
 
 		uint32_t timestamp_commandReceived = 0;
 		bool receiveTimeout = false;
 
+        //thermal model (I²t)
+        thermalModel thermalMotor; //winding (slow)
+        thermalModel thermalDriver; //driver channel (fast)
+
         //traction control system
+        tractionControl tcs;
         uint32_t tcs_timestampLastSpeedUpdate = 0; //track speedsensor update
-        int64_t tcs_timestampBeginExceeded = 0; //track start of event
-        uint32_t tcs_usExceeded = 0; //sum up time
-        bool tcs_isExceeded = false; //is currently too fast
-        int64_t tcs_timestampLastRun = 0;
+        bool tcs_isExceeded = false; //is currently slipping
+        bool abs_isActive = false; //brake strength currently reduced by anti-lock brake
+        bool abs_brakeActivePrev = false; //braking in previous cycle (detect new brake event)
 
         //brake (decel boost)
         uint32_t timestampBrakeStart = 0;
@@ -141,7 +236,21 @@ class controlledMotor {
 //====================================
 //========== motorctl task ===========
 //====================================
-// note: pointer to a 'controlledMotor' object has to be provided as task-parameter
-// runs handle method of certain motor repeatedly: 
-// receives commands from control via queue, handle ramp and current, apply new duty by passing it to method of motordriver (ptr)
-void task_motorctl( void * controlledMotor );
+// struct with variables passed to task from main
+typedef struct motorctl_task_parameters_t {
+    controlledMotor * motorLeft;
+    controlledMotor * motorRight;
+    uint32_t usControlPeriod; //period the handle function is run with (e.g. 2000 => 500Hz)
+    float powerBudgetW; //max total power of both motors (current * battery voltage), 0 = disabled
+    float (*getBatteryVoltage)(); //board specific battery voltage (read via adc service), NULL = unknown
+} motorctl_task_parameters_t;
+
+//bits of task notification value used to wake the motorctl task
+#define MOTORCTL_NOTIFY_TICK (1 << 0)    //periodic control timer
+#define MOTORCTL_NOTIFY_COMMAND (1 << 1) //new command from setTarget
+
+// note: pointer to a 'motorctl_task_parameters_t' struct has to be provided as task-parameter
+// runs handle method of both motors in lock-step (woken by new commands, and by esp_timer at a fixed rate while a motor needs it):
+// takes one snapshot of both motors, receives commands from control via queue, handle ramp and current,
+// then applies both new duties by passing them to method of motordriver (ptr)
+void task_motorctl( void * task_motorctl_parameters );
@@ -0,0 +1,42 @@
+#include "odometry.hpp"
+#include <math.h>
+
+
+//============================
+//======= constructor ========
+//============================
+chassisOdometry::chassisOdometry(speedSensor * left, speedSensor * right, float trackWidthMeter){
+    sensorLeft = left;
+    sensorRight = right;
+    trackWidth = trackWidthMeter;
+    reset();
+}
+
+
+
+//===========================
+//========== reset ==========
+//===========================
+void chassisOdometry::reset(){
+    distanceLeftAtReset = sensorLeft->getDistanceMeter();
+    distanceRightAtReset = sensorRight->getDistanceMeter();
+}
+
+
+
+//===========================
+//======= get values ========
+//===========================
+float chassisOdometry::getDistanceMeter(){
+    double left = sensorLeft->getDistanceMeter() - distanceLeftAtReset;
+    double right = sensorRight->getDistanceMeter() - distanceRightAtReset;
+    return (left + right) / 2;
+}
+
+//difference of both wheel distances divided by track width = rotation in radians
+float chassisOdometry::getHeadingChangeDeg(){
+    if (trackWidth <= 0) return 0;
+    double left = sensorLeft->getDistanceMeter() - distanceLeftAtReset;
+    double right = sensorRight->getDistanceMeter() - distanceRightAtReset;
+    return (right - left) / trackWidth * 180 / M_PI;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "speedsensor.hpp"
+
+
+//====================================
+//====== chassisOdometry class =======
+//====================================
+//combined distance and heading change of the chassis from the distance counters of both wheels (differential drive)
+//- cheap lookup: calculated from pulse counts on request, no integration of speed needed
+//- values are relative to the last reset()
+class chassisOdometry {
+    public:
+        chassisOdometry(speedSensor * left, speedSensor * right, float trackWidthMeter);
+
+        void reset(); //set current position as reference
+        float getDistanceMeter(); //signed distance of chassis center (forward positive)
+        float getHeadingChangeDeg(); //rotation of chassis (positive = turned left / counter-clockwise)
+
+    private:
+        speedSensor * sensorLeft;
+        speedSensor * sensorRight;
+        float trackWidth; //distance between the wheels
+        double distanceLeftAtReset = 0;
+        double distanceRightAtReset = 0;
+};
@@ -0,0 +1,84 @@
+#include "pid.hpp"
+
+
+//=============================
+//======== constructor ========
+//=============================
+pidController::pidController(pidGains_t gains_f, float outputMin_f, float outputMax_f){
+    gains = gains_f;
+    outputMin = outputMin_f;
+    outputMax = outputMax_f;
+}
+
+
+
+//============================
+//========== update ==========
+//============================
+//calculate new controller output from setpoint and measurement
+//dtSeconds: time passed since last update, feedforward: added to output before clamping (e.g. expected duty)
+float pidController::update(float setpoint, float measurement, float dtSeconds, float feedforward){
+    float error = setpoint - measurement;
+
+    //--- derivative (of measurement) ---
+    float derivative = 0;
+    if (!firstRun && dtSeconds > 0)
+        derivative = -(measurement - measurementPrev) / dtSeconds;
+    measurementPrev = measurement;
+    firstRun = false;
+
+    //--- output without new integral part ---
+    float outputUnclamped = feedforward + gains.kp * error + integral + gains.kd * derivative;
+
+    //--- integral with anti-windup ---
+    //only integrate when output is not saturated or error reduces the saturation
+    float integralIncrement = gains.ki * error * dtSeconds;
+    if (!(outputUnclamped >= outputMax && integralIncrement > 0)
+        && !(outputUnclamped <= outputMin && integralIncrement < 0))
+    {
+        integral += integralIncrement;
+        outputUnclamped += integralIncrement;
+    }
+
+    //--- clamp output ---
+    saturated = true;
+    if (outputUnclamped > outputMax)
+        output = outputMax;
+    else if (outputUnclamped < outputMin)
+        output = outputMin;
+    else {
+        output = outputUnclamped;
+        saturated = false;
+    }
+    //limit integral to output range (e.g. when limits changed)
+    if (integral > outputMax - outputMin) integral = outputMax - outputMin;
+    else if (integral < outputMin - outputMax) integral = outputMin - outputMax;
+
+    return output;
+}
+
+
+
+//===========================
+//========== reset ==========
+//===========================
+//reset controller state
+//outputNow: preload integral with that value so there is no jump when the controller (re)starts at a certain output
+void pidController::reset(float outputNow){
+    integral = outputNow;
+    firstRun = true;
+    output = outputNow;
+    saturated = false;
+}
+
+
+
+//=================================
+//========= trackOutput ===========
+//=================================
+//back-calculation: when the applied output differs from the calculated one (limited elsewhere),
+//the integral is corrected by the difference so it does not keep growing against the limit
+void pidController::trackOutput(float outputApplied){
+    integral += outputApplied - output;
+    output = outputApplied;
+}
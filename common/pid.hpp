@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//--- pidGains_t ---
+//gains of a pid controller (e.g. stored in nvs)
+typedef struct pidGains_t {
+    float kp; //proportional
+    float ki; //integral (per second)
+    float kd; //derivative (seconds)
+} pidGains_t;
+
+
+//===================================
+//======= pidController class =======
+//===================================
+//pid controller with optional feedforward input
+//- output is clamped to configured limits
+//- anti-windup: integral stops growing while output is saturated in the same direction
+//  or follows the output actually applied when it was limited elsewhere (trackOutput)
+//- derivative is calculated from measurement (no kick when setpoint changes)
+class pidController {
+    public:
+        //--- constructor ---
+        pidController(pidGains_t gains, float outputMin, float outputMax);
+
+        //--- functions ---
+        //calculate new output, has to be run repeatedly with time passed since last run
+        float update(float setpoint, float measurement, float dtSeconds, float feedforward = 0);
+        //reset integral and derivative state, optionally preload integral so next output starts at certain value (bumpless)
+        void reset(float outputNow = 0);
+        //adjust integral to output actually applied (e.g. limited further outside of the controller), no windup
+        void trackOutput(float outputApplied);
+        void setGains(pidGains_t gainsNew) {gains = gainsNew;};
+        pidGains_t getGains() const {return gains;};
+        void setOutputLimits(float min, float max) {outputMin = min; outputMax = max;};
+        float getOutput() const {return output;};
+        bool isSaturated() const {return saturated;};
+
+    private:
+        //--- variables ---
+        pidGains_t gains;
+        float outputMin;
+        float outputMax;
+        float integral = 0;
+        float measurementPrev = 0;
+        bool firstRun = true;
+        float output = 0;
+        bool saturated = false;
+};
@@ -0,0 +1,89 @@
+#include "ramp.hpp"
+
+
+//============================
+//========== update ==========
+//============================
+//move value towards target using the configured rate and jerk limits
+void rampGenerator::update(float * value, float target, float dtSeconds, const rampLimits_t &limits){
+    float delta = target - *value;
+    //already at target
+    if (delta == 0) {
+        rate = 0;
+        return;
+    }
+    float direction = (delta > 0) ? 1 : -1;
+
+    //--- select limits ---
+    //accelerating when absolute value increases (same sign or starting at 0)
+    bool accelerating = (*value == 0) || ((*value > 0) == (delta > 0));
+    float rateMax = accelerating ? limits.rateAccel : limits.rateDecel;
+    float jerkMax = accelerating ? limits.jerkAccel : limits.jerkDecel;
+    //distance until phase changes (decelerating: until 0 is crossed)
+    float distance = fabs(delta);
+    if (!accelerating && fabs(*value) < distance)
+        distance = fabs(*value);
+
+    //--- no limit ---
+    if (isinf(rateMax)) {
+        *value = target;
+        rate = 0;
+        return;
+    }
+
+    //--- apply new limits to current rate ---
+    //target changed to other direction: rate of previous movement does not apply anymore
+    if (rate * direction < 0)
+        rate = 0;
+    //rate above limit (limit lowered e.g. by ABS, or 0 crossed from faster decel into slower accel)
+    if (fabs(rate) > rateMax)
+        rate = direction * rateMax;
+
+    //--- define desired rate ---
+    float rateDesired = rateMax;
+    if (jerkMax > 0) {
+        //limit rate so it can be reduced to 0 with max jerk until target is reached (no overshoot)
+        //note: when decelerating towards 0 and target is on the other side, rate does not have to reach 0 at 0
+        float rateStop = sqrtf(2 * jerkMax * fabs(delta));
+        if (rateStop < rateDesired) rateDesired = rateStop;
+    }
+    rateDesired *= direction;
+
+    //--- change rate towards desired rate ---
+    if (jerkMax > 0) {
+        float rateStep = jerkMax * dtSeconds;
+        if (rateDesired > rate + rateStep) rate += rateStep;
+        else if (rateDesired < rate - rateStep) rate -= rateStep;
+        else rate = rateDesired;
+    } else {
+        rate = rateDesired; //linear ramp
+    }
+
+    //--- apply rate ---
+    float step = rate * dtSeconds;
+    //no movement when rate points in other direction (still reducing rate)
+    if (step * direction <= 0)
+        return;
+    //dont move further than next phase change / target
+    if (fabs(step) >= distance) {
+        *value += direction * distance;
+        if (distance == fabs(delta)) { //target reached
+            *value = target;
+            rate = 0;
+        }
+        return;
+    }
+    *value += step;
+}
+
+
+
+//============================
+//======= jerkFromTime =======
+//============================
+//get jerk that increases the rate from 0 to provided rate within provided time
+//returns 0 (jerk disabled) when time is 0 or rate unlimited
+float rampGenerator::jerkFromTime(float rate, uint32_t msToFullRate){
+    if (msToFullRate == 0 || isinf(rate)) return 0;
+    return rate / ((float)msToFullRate / 1000);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+
+//--- rampLimits_t ---
+//limits used by rampGenerator for one step
+//rate: max change of value per second (e.g. %/s), RAMP_UNLIMITED = jump to target immediately
+//jerk: max change of rate per second (e.g. %/s^2), 0 = disabled (linear ramp, rate changes immediately)
+#define RAMP_UNLIMITED INFINITY
+typedef struct rampLimits_t {
+    float rateAccel; //used while absolute value increases (moving away from 0)
+    float jerkAccel;
+    float rateDecel; //used while absolute value decreases (moving towards 0)
+    float jerkDecel;
+} rampLimits_t;
+
+
+//===================================
+//======= rampGenerator class =======
+//===================================
+//jerk limited (S-curve) ramp e.g. for motor duty
+//- the rate of change is limited (acceleration) and changes gradually itself (jerk)
+//- rate is reduced in time to reach the target without overshoot
+//- different limits for increasing and decreasing absolute value (accel / decel)
+class rampGenerator {
+    public:
+        //--- functions ---
+        //move value towards target by one step with time passed since last step
+        //note: value is passed by pointer, since it may be modified elsewhere too (e.g. current limit)
+        void update(float * value, float target, float dtSeconds, const rampLimits_t &limits);
+        void reset() {rate = 0;}; //stop immediately (e.g. when value was forced to a different value)
+        float getRate() const {return rate;};
+
+        //get jerk that reaches the provided rate within certain time (0 => disabled)
+        static float jerkFromTime(float rate, uint32_t msToFullRate);
+
+    private:
+        //--- variables ---
+        float rate = 0; //current rate of change (per second, signed)
+};
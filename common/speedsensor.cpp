@@ -1,5 +1,11 @@
 #include "speedsensor.hpp"
 #include "esp_timer.h"
+#include <stdio.h>
+#include <math.h>
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
 #include <ctime>
 
 //===== config =====
@@ -9,6 +15,9 @@ static const char* TAG = "speedSensor";
 
 //initialize ISR only once (for multiple instances)
 bool speedSensor::isrIsInitialized = false;
+//sensors using capture backend (index = capture channel)
+speedSensor * speedSensor::captureSensors[3] = {};
+uint8_t speedSensor::captureSensorCount = 0;
 
 
 uint32_t min(uint32_t a, uint32_t b){
@@ -21,80 +30,412 @@ uint32_t min(uint32_t a, uint32_t b){
 //=========================================
 //========== ISR onEncoderRising ==========
 //=========================================
-//handle gpio rising edge event
+//handle gpio rising edge event (GPIO_ISR backend)
 //determines direction and rotational speed with a speedSensor object
 void IRAM_ATTR onEncoderRising(void *arg)
 {
 	speedSensor *sensor = (speedSensor *)arg;
-	int currentState = gpio_get_level(sensor->config.gpioPin);
-
 	// time since last edge in us
 	uint32_t currentTime = esp_timer_get_time();
-	uint32_t timeElapsed = currentTime - sensor->lastEdgeTime;
-	sensor->lastEdgeTime = currentTime; // update last edge time
+	sensor->processEdge(currentTime - sensor->lastEdgeTime, currentTime);
+}
 
-	// store duration of last pulse
-	sensor->pulseDurations[sensor->pulseCounter] = timeElapsed;
-	sensor->pulseCounter++;
 
-	// check if 3rd pulse has occoured (one sequence recorded)
-	if (sensor->pulseCounter >= 3)
-	{
-		sensor->pulseCounter = 0; // reset count
 
-		// simplify variable names
-		uint32_t pulse1 = sensor->pulseDurations[0];
-		uint32_t pulse2 = sensor->pulseDurations[1];
-		uint32_t pulse3 = sensor->pulseDurations[2];
+//=========================================
+//=========== ISR onCapture ===============
+//=========================================
+//handle edge captured by MCPWM (MCPWM_CAPTURE backend)
+//only stores the hardware timestamp, evaluation is done in batches by task_speedSensorCapture
+static bool IRAM_ATTR onCapture(mcpwm_unit_t mcpwm, mcpwm_capture_channel_id_t channel, const cap_event_data_t *edata, void *arg)
+{
+	speedSensor *sensor = (speedSensor *)arg;
+	uint32_t head = sensor->captureHead.load(std::memory_order_relaxed);
+	if (head - sensor->captureTail.load(std::memory_order_acquire) >= SPEED_CAPTURE_BUFFER_SIZE) {
+		sensor->debug_countCaptureOverflow++; //task did not keep up, edge lost
+		return false;
+	}
+	sensor->captureTicks[head % SPEED_CAPTURE_BUFFER_SIZE] = edata->cap_value;
+	sensor->captureHead.store(head + 1, std::memory_order_release);
+	return false; //no task woken
+}
 
-		// save all recored pulses of this sequence (for logging only)
-		sensor->pulse1 = pulse1;
-		sensor->pulse2 = pulse2;
-		sensor->pulse3 = pulse3;
 
-		// find shortest pulse
-		sensor->shortestPulse = min(pulse1, min(pulse2, pulse3));
 
-		// ignore this pulse sequence if one pulse is too short (possible noise)
-		if (sensor->shortestPulse < sensor->config.minPulseDurationUs)
+//===================================
+//===== task_speedSensorCapture =====
+//===================================
+//regularly evaluate edges captured by all sensors using the MCPWM_CAPTURE backend
+#define CAPTURE_DRAIN_INTERVAL_MS 10 //latency of speed updates (one control cycle)
+static void task_speedSensorCapture(void *arg)
+{
+	speedSensor ** sensors = (speedSensor **)arg;
+	while (1) {
+		for (int i = 0; i < 3; i++)
+			if (sensors[i] != NULL) sensors[i]->drainCaptures();
+		vTaskDelay(CAPTURE_DRAIN_INTERVAL_MS / portTICK_PERIOD_MS);
+	}
+}
+
+
+
+//=========================================
+//============= processEdge ===============
+//=========================================
+//phase-locking decoder: evaluate pulse sequence with duration of the pulse that just ended
+//- ACQUIRE: collect 3 plausible pulses (one short/medium/long sequence) => lock to the pattern
+//- LOCKED: each new pulse is compared to the durations of the previous sequence, best match wins:
+//  next pattern step     => regular edge
+//  newest pulse again    => direction reversed, continue with pattern of opposite direction
+//  next 2 or 3 steps     => missed edge(s), pulse is split according to the previous sequence
+//  shorter than expected => extra edge (noise), merged with following pulse
+//  no match              => lock lost, resynchronize starting with this pulse
+//sliding window over the last 3 pulses => new speed and direction on every edge (not only every 3rd)
+//note: run in ISR with GPIO_ISR backend => keep IRAM_ATTR and short
+#define PULSE_MATCH_TOLERANCE_NUM 3 //pulse matches expected duration when within factor 2/3 to 3/2
+#define PULSE_MATCH_TOLERANCE_DEN 2
+//possible interpretations of a pulse while locked
+enum {PULSE_REGULAR = 0, PULSE_REVERSAL, PULSE_MISSED_1, PULSE_MISSED_2};
+
+static inline bool IRAM_ATTR pulseMatches(uint32_t pulse, uint32_t expected){
+	return (uint64_t)pulse * PULSE_MATCH_TOLERANCE_NUM >= (uint64_t)expected * PULSE_MATCH_TOLERANCE_DEN
+		&& (uint64_t)pulse * PULSE_MATCH_TOLERANCE_DEN <= (uint64_t)expected * PULSE_MATCH_TOLERANCE_NUM;
+}
+
+void IRAM_ATTR speedSensor::processEdge(uint32_t timeElapsed, uint32_t currentTime)
+{
+	lastEdgeTime = currentTime; // update last edge time
+	decoderStats.edges++;
+
+	// wheel was stopped: pulses before are not part of the current sequence
+	if (timeElapsed > TIMEOUT_NO_ROTATION * 1000)
+	{
+		pulsesRecorded = 0;
+		pulsesUncounted = 0;
+		pendingPulse = 0;
+		locked = false;
+		return;
+	}
+
+	//--- ACQUIRE ---
+	if (!locked)
+	{
+		// ignore too short pulse (possible noise), sequence has to start again
+		if (timeElapsed < config.minPulseDurationUs)
 		{
-			sensor->debug_countIgnoredSequencesTooShort++;
+			debug_countIgnoredSequencesTooShort++;
+			pulsesRecorded = 0;
+			pulsesUncounted = 0;
 			return;
 		}
+		pushPulse(timeElapsed);
+		if (pulsesRecorded >= 3)
+		{
+			locked = true;
+			evaluateWindow(currentTime);
+		}
+		return;
+	}
+
+	//--- LOCKED ---
+	uint32_t pulse = pendingPulse + timeElapsed;
+	// expected durations (same classes one sequence earlier):
+	// next pattern step, newest pulse again (reversal), next 2 steps (1 edge missed), next 3 steps (2 edges missed)
+	uint32_t expected[4];
+	expected[PULSE_REGULAR] = pulseDurations[pulseCounter];
+	expected[PULSE_REVERSAL] = pulseDurations[(pulseCounter + 2) % 3];
+	expected[PULSE_MISSED_1] = expected[PULSE_REGULAR] + pulseDurations[(pulseCounter + 1) % 3];
+	expected[PULSE_MISSED_2] = expected[PULSE_MISSED_1] + expected[PULSE_REVERSAL];
+	// best matching expectation (candidates can overlap depending on the disk pattern)
+	int match = -1;
+	uint32_t matchError = UINT32_MAX;
+	for (int i = 0; i < 4; i++)
+	{
+		if (!pulseMatches(pulse, expected[i])) continue;
+		uint32_t error = (uint64_t)(pulse > expected[i] ? pulse - expected[i] : expected[i] - pulse) * 1024 / expected[i];
+		if (error < matchError)
+		{
+			match = i;
+			matchError = error;
+		}
+	}
 
-		//--- Determine direction based on pulse order ---
-		int direction = 0;
-		if (sensor->shortestPulse == pulse1) // short...
+	switch (match)
+	{
+	case PULSE_REGULAR:
+		pendingPulse = 0;
+		decoderStats.accepted++;
+		pushPulse(pulse);
+		break;
+	case PULSE_REVERSAL:
+		// same gap passed again => reorder window to the sequence of the opposite direction and stay locked
+		{
+			pendingPulse = 0;
+			decoderStats.accepted++;
+			uint32_t oldest = pulseDurations[pulseCounter];
+			pulseDurations[pulseCounter] = pulseDurations[(pulseCounter + 1) % 3];
+			pulseDurations[(pulseCounter + 1) % 3] = oldest;
+			pulseDurations[(pulseCounter + 2) % 3] = pulse;
+			pulsesUncounted++;
+		}
+		break;
+	case PULSE_MISSED_1:
+		// one edge missed: split according to the previous sequence
 		{
-			if (pulse2 < pulse3) // short-medium-long -->
-				direction = 1;
-			else // short-long-medium <--
-				direction = -1;
+			pendingPulse = 0;
+			decoderStats.missedEdges++;
+			uint32_t part1 = (uint64_t)pulse * expected[PULSE_REGULAR] / expected[PULSE_MISSED_1];
+			pushPulse(part1);
+			pushPulse(pulse - part1);
 		}
-		else if (sensor->shortestPulse == pulse3) //...short
+		break;
+	case PULSE_MISSED_2:
+		// two edges missed: whole sequence, scale previous sequence
 		{
-			if (pulse1 > pulse2) // long-medium-short <--
-				direction = -1;
-			else // medium-long-short -->
-				direction = 1;
+			pendingPulse = 0;
+			decoderStats.missedEdges += 2;
+			uint32_t part1 = (uint64_t)pulse * expected[PULSE_REGULAR] / expected[PULSE_MISSED_2];
+			uint32_t part2 = (uint64_t)pulse * (expected[PULSE_MISSED_1] - expected[PULSE_REGULAR]) / expected[PULSE_MISSED_2];
+			pushPulse(part1);
+			pushPulse(part2);
+			pushPulse(pulse - part1 - part2);
 		}
-		else if (sensor->shortestPulse == pulse2) //...short...
+		break;
+	default:
+		if (pulse < expected[PULSE_REGULAR])
 		{
-			if (pulse1 < pulse3) // medium-short-long
-				direction = -1;
-			else // long-short-medium
-				direction = 1;
+			// extra edge: pulse fragment, wait for rest of the pulse
+			pendingPulse = pulse;
+			decoderStats.extraEdges++;
+			return;
 		}
+		// pattern lost (e.g. strong speed change, multiple noise edges) => resynchronize with this pulse
+		decoderStats.resyncs++;
+		locked = false;
+		pendingPulse = 0;
+		pulsesRecorded = 0;
+		pulsesUncounted = 0;
+		if (pulse >= config.minPulseDurationUs) pushPulse(pulse);
+		return;
+	}
+	evaluateWindow(currentTime);
+}
+
 
-		// save and invert direction if necessay
-		if (sensor->config.directionInverted)
-			direction = -direction;
 
-		// calculate rotational speed
-		uint64_t pulseSum = pulse1 + pulse2 + pulse3;
-		sensor->currentRpm = direction * (sensor->config.degreePerGroup / 360.0 * 60.0 / ((double)pulseSum / 1000000.0));
-		sensor->timeLastUpdate = currentTime;
+//=========================================
+//============== pushPulse ================
+//=========================================
+//store duration of a pulse (ring buffer, pulseCounter = index of oldest pulse afterwards)
+void IRAM_ATTR speedSensor::pushPulse(uint32_t duration)
+{
+	pulseDurations[pulseCounter] = duration;
+	pulseCounter = (pulseCounter + 1) % 3;
+	if (pulsesRecorded < 3) pulsesRecorded++;
+	pulsesUncounted++; //direction known after evaluation
+}
+
+
+
+//=========================================
+//============ evaluateWindow =============
+//=========================================
+//determine direction and speed from the last 3 pulses (one complete sequence)
+void IRAM_ATTR speedSensor::evaluateWindow(uint32_t currentTime)
+{
+	// simplify variable names (oldest to newest)
+	uint32_t pulse1 = pulseDurations[pulseCounter];
+	uint32_t pulse2 = pulseDurations[(pulseCounter + 1) % 3];
+	uint32_t pulse3 = pulseDurations[(pulseCounter + 2) % 3];
+
+	// save all recored pulses of this sequence (for logging only)
+	state.pulse1 = pulse1;
+	state.pulse2 = pulse2;
+	state.pulse3 = pulse3;
+
+	// find shortest pulse
+	uint32_t shortestPulse = min(pulse1, min(pulse2, pulse3));
+
+	//--- Determine direction based on pulse order ---
+	int direction = 0;
+	if (shortestPulse == pulse1) // short...
+	{
+		if (pulse2 < pulse3) // short-medium-long -->
+			direction = 1;
+		else // short-long-medium <--
+			direction = -1;
+	}
+	else if (shortestPulse == pulse3) //...short
+	{
+		if (pulse1 > pulse2) // long-medium-short <--
+			direction = -1;
+		else // medium-long-short -->
+			direction = 1;
+	}
+	else if (shortestPulse == pulse2) //...short...
+	{
+		if (pulse1 < pulse3) // medium-short-long
+			direction = -1;
+		else // long-short-medium
+			direction = 1;
+	}
+
+	// save and invert direction if necessay
+	if (config.directionInverted)
+		direction = -direction;
+	if (direction != directionPrev && directionPrev != 0)
+		decoderStats.directionChanges++;
+	directionPrev = direction;
+
+	// count pulses (distance) since last evaluation with now known direction
+	state.pulseCount += direction * (int64_t)pulsesUncounted;
+	state.pulseCountAbs += pulsesUncounted;
+	pulsesUncounted = 0;
+
+	// calculate rotational speed (integer only, converted by reader)
+	uint64_t pulseSum = (uint64_t)pulse1 + pulse2 + pulse3;
+	state.measuredMdps = direction * (int32_t)((uint64_t)groupMdeg * 1000000 / pulseSum);
+	// angle of the pulse that starts now (same class as oldest pulse in window), bounds speed while waiting for next edge
+	uint32_t nextPulseMdeg = (uint64_t)groupMdeg * pulseDurations[pulseCounter] / pulseSum;
+	observeSpeed(state.measuredMdps, nextPulseMdeg, currentTime);
+	publishSnapshot();
+}
+
+
+
+//=========================================
+//============= observeSpeed ==============
+//=========================================
+//alpha-beta observer: fuse new speed measurement into smoothed speed and acceleration
+//note: run in ISR with GPIO_ISR backend => fixed point integer math only
+#define OBSERVER_ALPHA_PERCENT 50 //weight of speed residual
+#define OBSERVER_BETA_PERCENT 20  //weight of speed residual for acceleration
+#define OBSERVER_ACCEL_MAX_MDPS2 100000000 //clamp acceleration (~16700rpm/s), residual / very short dt must not overflow int32
+void IRAM_ATTR speedSensor::observeSpeed(int32_t measuredMdps, uint32_t nextPulseMdeg, uint32_t currentTime)
+{
+	uint32_t dtUs = currentTime - state.timeUpdate;
+	// (re)start from measurement after standstill or direction change
+	if (state.speedMdps == 0 || (measuredMdps > 0) != (state.speedMdps > 0) || dtUs == 0 || dtUs > TIMEOUT_NO_ROTATION * 1000)
+	{
+		state.speedMdps = measuredMdps;
+		state.accelMdps2 = 0;
 	}
+	else
+	{
+		int64_t predicted = state.speedMdps + (int64_t)state.accelMdps2 * dtUs / 1000000;
+		int64_t residual = measuredMdps - predicted;
+		state.speedMdps = predicted + residual * OBSERVER_ALPHA_PERCENT / 100;
+		int64_t accel = state.accelMdps2 + residual * OBSERVER_BETA_PERCENT * 10000 / dtUs; //beta * residual / dt[s]
+		if (accel > OBSERVER_ACCEL_MAX_MDPS2) accel = OBSERVER_ACCEL_MAX_MDPS2;
+		else if (accel < -OBSERVER_ACCEL_MAX_MDPS2) accel = -OBSERVER_ACCEL_MAX_MDPS2;
+		state.accelMdps2 = accel;
+	}
+	state.nextPulseMdeg = nextPulseMdeg;
+	state.timeUpdate = currentTime;
+}
+
+
+
+//=========================================
+//=========== publishSnapshot =============
+//=========================================
+//copy working state to snapshot read by other tasks (sequence lock, single writer)
+void IRAM_ATTR speedSensor::publishSnapshot()
+{
+	snapshotSeq = snapshotSeq + 1; //odd: update in progress (readers retry)
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	snapshot = state;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	snapshotSeq = snapshotSeq + 1;
+}
+
+
+
+//=========================================
+//============ readSnapshot ===============
+//=========================================
+//consistent copy of the last published state (retry while writer is active)
+speedSensor_snapshot_t speedSensor::readSnapshot()
+{
+	speedSensor_snapshot_t copy;
+	uint32_t seq;
+	do {
+		seq = snapshotSeq;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		copy = snapshot;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	} while ((seq & 1) || seq != snapshotSeq);
+	return copy;
+}
+
+
+
+//=========================================
+//============ getEstimate ================
+//=========================================
+//speed and acceleration estimate of a snapshot at the provided time (rpm, rpm/s)
+//- decelerating: extrapolate with estimated acceleration (not past 0)
+//- no edge for a long time: the pulse that started at the last edge is not finished yet
+//  => average speed since then is at most (angle of that pulse / time since edge), estimate decays smoothly towards 0
+#define MDPS_PER_RPM 6000.0 //1rpm = 360deg/60s
+void speedSensor::getEstimate(const speedSensor_snapshot_t &snap, uint32_t timeNow, double * rpm, double * accel)
+{
+	*rpm = 0;
+	*accel = 0;
+	uint32_t usSinceEdge = timeNow - snap.timeUpdate;
+	if (snap.speedMdps == 0 || usSinceEdge > TIMEOUT_NO_ROTATION * 1000) return;
+	double secSinceEdge = usSinceEdge / 1000000.0;
+	double speed = snap.speedMdps / MDPS_PER_RPM;
+	double acceleration = snap.accelMdps2 / MDPS_PER_RPM;
+	double estimate = speed;
+	*accel = acceleration;
+	if (acceleration * speed < 0)
+	{
+		estimate = speed + acceleration * secSinceEdge;
+		if (estimate * speed <= 0) {
+			*accel = 0;
+			return;
+		}
+	}
+	double bound = snap.nextPulseMdeg / MDPS_PER_RPM / secSinceEdge;
+	if (fabs(estimate) > bound)
+	{
+		estimate = estimate > 0 ? bound : -bound;
+		*accel = -estimate / secSinceEdge; //derivative of bound
+	}
+	*rpm = estimate;
+}
+
+
+
+//=========================================
+//============ drainCaptures ==============
+//=========================================
+//evaluate all edges captured since last run
+//pulse durations are calculated from hardware timestamps (no ISR latency jitter)
+//edge time: newest edge of the batch is taken as happened now, earlier edges are placed before it by their tick difference
+//=> every edge gets its own timestamp (observer dt), the whole batch is max CAPTURE_DRAIN_INTERVAL_MS late
+#define CAPTURE_TICKS_PER_US 80 //capture timer runs with APB clock (80MHz)
+void speedSensor::drainCaptures()
+{
+	uint32_t now = esp_timer_get_time();
+	uint32_t tail = captureTail.load(std::memory_order_relaxed);
+	uint32_t head = captureHead.load(std::memory_order_acquire);
+	//note: slots up to head are not written by ISR until tail is advanced
+	uint32_t ticksNewest = captureTicks[(head - 1) % SPEED_CAPTURE_BUFFER_SIZE];
+	for (; tail != head; tail++) {
+		uint32_t ticks = captureTicks[tail % SPEED_CAPTURE_BUFFER_SIZE];
+		uint32_t edgeTime = now - (ticksNewest - ticks) / CAPTURE_TICKS_PER_US;
+		//first edge: no previous hardware timestamp, use time since last edge
+		uint32_t timeElapsed = captureHasPrev ? (ticks - captureTicksPrev) / CAPTURE_TICKS_PER_US : edgeTime - lastEdgeTime;
+		captureTicksPrev = ticks;
+		captureHasPrev = true;
+		processEdge(timeElapsed, edgeTime);
+	}
+	captureTail.store(tail, std::memory_order_release);
+	//capture timer (32 bit) overflows after ~53s => previous timestamp invalid after standstill
+	if (captureHasPrev && now - lastEdgeTime > TIMEOUT_NO_ROTATION * 1000)
+		captureHasPrev = false;
 }
 
 
@@ -103,9 +444,13 @@ void IRAM_ATTR onEncoderRising(void *arg)
 //============================
 //======= constructor ========
 //============================
-speedSensor::speedSensor(speedSensor_config_t config_f){
+speedSensor::speedSensor(speedSensor_config_t config_f, nvs_handle_t * nvsHandle_f){
 	//copy config
 	config = config_f;
+	nvsHandle = nvsHandle_f;
+	groupMdeg = config.degreePerGroup * 1000;
+	//load persisted odometer
+	loadOdometer();
 	//init gpio and ISR
 	init();
 }
@@ -115,8 +460,21 @@ speedSensor::speedSensor(speedSensor_config_t config_f){
 //==========================
 //========== init ==========
 //==========================
- //initializes gpio pin and configures interrupt
+//initializes configured backend
 void speedSensor::init() {
+	if (config.backend == SPEED_BACKEND_MCPWM_CAPTURE)
+		initCapture();
+	else
+		initGpioIsr();
+}
+
+
+
+//=========================
+//====== initGpioIsr ======
+//=========================
+//initializes gpio pin and configures interrupt
+void speedSensor::initGpioIsr() {
 	//configure pin
 	gpio_pad_select_gpio(config.gpioPin);
 	gpio_set_direction(config.gpioPin, GPIO_MODE_INPUT);
@@ -135,33 +493,69 @@ void speedSensor::init() {
 
 
 
+//=========================
+//====== initCapture ======
+//=========================
+//routes gpio pin to MCPWM capture channel, edges are timestamped by hardware
+//and evaluated by one task shared by all sensors
+void speedSensor::initCapture() {
+	if (captureSensors[config.captureChannel] != NULL) {
+		ESP_LOGE(TAG, "[%s] capture channel %d already used by '%s' - falling back to gpio interrupt",
+				 config.logName, (int)config.captureChannel, captureSensors[config.captureChannel]->config.logName);
+		initGpioIsr();
+		return;
+	}
+	//configure pin
+	mcpwm_gpio_init(MCPWM_UNIT_0, (mcpwm_io_signals_t)(MCPWM_CAP_0 + config.captureChannel), config.gpioPin);
+	gpio_set_pull_mode(config.gpioPin, GPIO_PULLUP_ONLY);
+
+	//configure capture channel
+	mcpwm_capture_config_t captureConfig = {
+		.cap_edge = MCPWM_POS_EDGE,
+		.cap_prescale = 1,
+		.capture_cb = onCapture,
+		.user_data = this,
+	};
+	ESP_ERROR_CHECK(mcpwm_capture_enable_channel(MCPWM_UNIT_0, config.captureChannel, &captureConfig));
+
+	//start task evaluating captured edges once
+	captureSensors[config.captureChannel] = this;
+	if (captureSensorCount++ == 0)
+		xTaskCreate(&task_speedSensorCapture, "task_speedCapture", 2048, captureSensors, 4, NULL); //below motorctl
+	ESP_LOGW(TAG, "[%s], configured gpio-pin %d as MCPWM capture channel %d", config.logName, (int)config.gpioPin, (int)config.captureChannel);
+}
+
+
+
 
 //==========================
 //========= getRpm =========
 //==========================
 //get rotational speed in revolutions per minute
 float speedSensor::getRpm(){
-	uint32_t timeElapsed = esp_timer_get_time() - lastEdgeTime;
-	//timeout (standstill)
-	//TODO variable timeout considering config.degreePerGroup
-	if ((currentRpm != 0) && (esp_timer_get_time() - lastEdgeTime) > TIMEOUT_NO_ROTATION*1000){
-		ESP_LOGI(TAG, "%s - timeout: no pulse within %dms... last pulse was %dms ago => set RPM to 0",
-				config.logName, TIMEOUT_NO_ROTATION, timeElapsed/1000);
-		currentRpm = 0;
-	}
+	double rpm, accel;
+	speedSensor_snapshot_t snap = readSnapshot();
+	getEstimate(snap, esp_timer_get_time(), &rpm, &accel);
 	//debug output (also log variables when this function is called)
-	ESP_LOGD(TAG, "[%s] getRpm: returning stored rpm=%.3f", config.logName, currentRpm);
-	ESP_LOGV(TAG, "[%s] rpm=%f, pulseCount=%d, p1=%d, p2=%d, p3=%d, shortest=%d, totalTooShortCount=%d",
+	ESP_LOGD(TAG, "[%s] getRpm: returning estimated rpm=%.3f (measured=%.3f, accel=%.1frpm/s)", config.logName, rpm, snap.measuredMdps / MDPS_PER_RPM, accel);
+	ESP_LOGV(TAG, "[%s] pulseCount=%lld, p1=%d, p2=%d, p3=%d, totalTooShortCount=%d, captureOverflows=%d, "
+			 "locked=%d, edges=%d, accepted=%d, extra=%d, missed=%d, resyncs=%d, dirChanges=%d",
 			 config.logName,
-			 currentRpm,
-			 pulseCounter,
-			 pulse1 / 1000,
-			 pulse2 / 1000,
-			 pulse3 / 1000,
-			 shortestPulse / 1000,
-			 debug_countIgnoredSequencesTooShort);
-	//return currently stored rpm
-	return currentRpm;
+			 snap.pulseCount,
+			 snap.pulse1 / 1000,
+			 snap.pulse2 / 1000,
+			 snap.pulse3 / 1000,
+			 debug_countIgnoredSequencesTooShort,
+			 debug_countCaptureOverflow,
+			 locked,
+			 decoderStats.edges,
+			 decoderStats.accepted,
+			 decoderStats.extraEdges,
+			 decoderStats.missedEdges,
+			 decoderStats.resyncs,
+			 decoderStats.directionChanges);
+	//return estimated rpm
+	return rpm;
 }
 
 
@@ -186,3 +580,138 @@ float speedSensor::getMps(){
 	ESP_LOGD(TAG, "%s - getMps: returning speed=%.3fm/s", config.logName, currentSpeed);
 	return currentSpeed;
 }
+
+
+
+//==================================
+//========= getAccelKmphs ==========
+//==================================
+//get estimated acceleration in km/h per second
+float speedSensor::getAccelKmphs(){
+	double rpm, accel;
+	getEstimate(readSnapshot(), esp_timer_get_time(), &rpm, &accel);
+	return accel * config.tireCircumferenceMeter * 60/1000;
+}
+
+
+
+//==========================
+//======== getState ========
+//==========================
+//speed, acceleration and update time from one snapshot evaluated at one time
+//=> no mix of different edges when an edge is evaluated between separate getter calls
+speedSensor_state_t speedSensor::getState(){
+	double rpm, accel;
+	speedSensor_snapshot_t snap = readSnapshot();
+	getEstimate(snap, esp_timer_get_time(), &rpm, &accel);
+	speedSensor_state_t stateNow = {
+		.speedKmph = (float)(rpm * config.tireCircumferenceMeter * 60/1000),
+		.accelKmphs = (float)(accel * config.tireCircumferenceMeter * 60/1000),
+		.timeUpdate = snap.timeUpdate
+	};
+	return stateNow;
+}
+
+
+
+//===============================
+//===== getTimeLastUpdate =======
+//===============================
+//time of last accepted edge (us)
+uint32_t speedSensor::getTimeLastUpdate(){
+	return readSnapshot().timeUpdate;
+}
+
+
+
+//===========================
+//===== pulse counting ======
+//===========================
+//note: counts are 64 bit and written in ISR (GPIO_ISR backend) => read from snapshot (no torn value)
+int64_t speedSensor::getPulseCount(){
+	return readSnapshot().pulseCount;
+}
+
+uint64_t speedSensor::getPulseCountAbs(){
+	return readSnapshot().pulseCountAbs;
+}
+
+//distance of one pulse (one group = short, medium and long pulse)
+double speedSensor::getMeterPerPulse(){
+	return config.tireCircumferenceMeter * config.degreePerGroup / 360.0 / 3;
+}
+
+//signed distance since boot (reverse subtracts)
+double speedSensor::getDistanceMeter(){
+	return getPulseCount() * getMeterPerPulse();
+}
+
+
+
+//===========================
+//======== odometer =========
+//===========================
+//odometers count absolute distance (both directions)
+double speedSensor::getOdometerTotalMeter(){
+	return odoTotalBaseMm / 1000.0 + getPulseCountAbs() * getMeterPerPulse();
+}
+
+double speedSensor::getOdometerTripMeter(){
+	return odoTripBaseMm / 1000.0 + (getPulseCountAbs() - odoTripStartPulses) * getMeterPerPulse();
+}
+
+void speedSensor::resetTrip(){
+	odoTripBaseMm = 0;
+	odoTripStartPulses = getPulseCountAbs();
+	ESP_LOGW(TAG, "[%s] trip odometer reset", config.logName);
+	saveOdometer(true);
+}
+
+
+
+//=============================
+//======= loadOdometer ========
+//=============================
+//keys: "<logName>-odo" and "<logName>-trip" (max 15 chars), values in mm
+void speedSensor::loadOdometer(){
+	if (nvsHandle == NULL) return;
+	char keyTotal[16], keyTrip[16];
+	snprintf(keyTotal, sizeof(keyTotal), "%s-odo", config.logName);
+	snprintf(keyTrip, sizeof(keyTrip), "%s-trip", config.logName);
+	uint64_t value;
+	if (nvs_get_u64(*nvsHandle, keyTotal, &value) == ESP_OK) odoTotalBaseMm = value;
+	if (nvs_get_u64(*nvsHandle, keyTrip, &value) == ESP_OK) odoTripBaseMm = value;
+	ESP_LOGW(TAG, "[%s] loaded odometer from nvs: total=%.3fkm, trip=%.3fkm", config.logName, odoTotalBaseMm / 1e6, odoTripBaseMm / 1e6);
+}
+
+
+
+//=============================
+//======= saveOdometer ========
+//=============================
+//write odometer to nvs when changed, bounded write frequency (flash wear)
+//note: caller should only run this while stopped (flash write stalls execution from flash)
+#define ODO_NVS_WRITE_INTERVAL_MS 60000 //write at most once per minute
+#define ODO_NVS_MIN_CHANGE_M 1          //write only when moved at least that far since last write
+void speedSensor::saveOdometer(bool force){
+	if (nvsHandle == NULL) return;
+	uint64_t pulses = getPulseCountAbs();
+	if (!force && ((pulses - odoPulsesLastWrite) * getMeterPerPulse() < ODO_NVS_MIN_CHANGE_M
+				   || esp_log_timestamp() - timestampOdoLastWrite < ODO_NVS_WRITE_INTERVAL_MS))
+		return;
+	char keyTotal[16], keyTrip[16];
+	snprintf(keyTotal, sizeof(keyTotal), "%s-odo", config.logName);
+	snprintf(keyTrip, sizeof(keyTrip), "%s-trip", config.logName);
+	uint64_t totalMm = getOdometerTotalMeter() * 1000;
+	uint64_t tripMm = getOdometerTripMeter() * 1000;
+	esp_err_t err = nvs_set_u64(*nvsHandle, keyTotal, totalMm);
+	if (err == ESP_OK) err = nvs_set_u64(*nvsHandle, keyTrip, tripMm);
+	if (err == ESP_OK) err = nvs_commit(*nvsHandle);
+	if (err != ESP_OK) {
+		ESP_LOGE(TAG, "[%s] failed writing odometer to nvs: %s", config.logName, esp_err_to_name(err));
+		return;
+	}
+	odoPulsesLastWrite = pulses;
+	timestampOdoLastWrite = esp_log_timestamp();
+	ESP_LOGI(TAG, "[%s] saved odometer to nvs: total=%.3fkm, trip=%.3fkm", config.logName, totalMm / 1e6, tripMm / 1e6);
+}
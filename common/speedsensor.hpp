@@ -3,16 +3,30 @@ extern "C" {
 #include "esp_log.h"
 #include "hal/gpio_types.h"
 #include "driver/gpio.h"
+#include "driver/mcpwm.h"
 #include "esp_timer.h"
+#include "nvs.h"
 }
+#include <atomic>
+
+#define SPEED_CAPTURE_BUFFER_SIZE 32 //captured edges buffered between two runs of the drain task (power of 2)
+
+//--- speedSensorBackend_t ---
+//how edges of the encoder are timestamped
+typedef enum {
+	SPEED_BACKEND_GPIO_ISR = 0,  //gpio interrupt, timestamp taken in ISR (jitter by interrupt latency)
+	SPEED_BACKEND_MCPWM_CAPTURE  //MCPWM capture unit timestamps edges in hardware, evaluated in batches by a task
+} speedSensorBackend_t;
 
 //Encoder disk requirements:
 //encoder disk has to have gaps in 3 differnt intervals (short, medium, long)
 //that pattern can be repeated multiple times, see config option
 typedef struct {
     gpio_num_t gpioPin;
+	speedSensorBackend_t backend;
+	mcpwm_capture_channel_id_t captureChannel; //capture channel of MCPWM unit 0 (only used by MCPWM_CAPTURE backend, unique per sensor)
 	float degreePerGroup;	//360 / [count of short,medium,long groups on encoder disk]
-	uint32_t minPulseDurationUs; //smallest possible pulse duration (time from start small-pulse to start long-pulse at full speed). Set to 0 to disable this noise detection
+	uint32_t minPulseDurationUs; //smallest possible pulse duration (time from start small-pulse to start long-pulse at full speed), shorter pulses are ignored while not locked to the pattern. Set to 0 to disable this noise detection
 	float tireCircumferenceMeter;
 	//default positive direction is pulse order "short, medium, long"
 	bool directionInverted;
@@ -20,11 +34,47 @@ typedef struct {
 } speedSensor_config_t;
 
 
+//--- speedSensor_snapshot_t ---
+//integer-only state published by the edge path (ISR or capture task) once per evaluated edge
+//readers copy it consistently via sequence lock and convert to float (see readSnapshot)
+//angular speeds in millidegree per second
+typedef struct {
+	int32_t speedMdps;       //observer speed estimate (signed)
+	int32_t accelMdps2;      //observer acceleration estimate (mdeg/s²)
+	int32_t measuredMdps;    //speed of the last pulse sequence
+	uint32_t nextPulseMdeg;  //angle of the pulse started at last edge
+	uint32_t timeUpdate;     //timestamp of last evaluated edge (us)
+	uint32_t pulse1, pulse2, pulse3; //durations of the last sequence (us)
+	int64_t pulseCount;      //signed pulse count since boot
+	uint64_t pulseCountAbs;  //pulses in any direction since boot
+} speedSensor_snapshot_t;
+
+
+//--- speedSensor_state_t ---
+//speed, acceleration and update time converted from one snapshot at one point in time (consistent set)
+typedef struct {
+	float speedKmph;
+	float accelKmphs;    //km/h per second
+	uint32_t timeUpdate; //timestamp of last evaluated edge (us)
+} speedSensor_state_t;
+
+
+//--- speedSensor_decoderStats_t ---
+//quality counters of the pattern decoder (since boot)
+typedef struct {
+	uint32_t edges;            //edges processed
+	uint32_t accepted;         //pulses matching the expected pattern step
+	uint32_t extraEdges;       //pulse fragments merged with the following pulse (noise)
+	uint32_t missedEdges;      //edges reconstructed from a too long pulse
+	uint32_t resyncs;          //pattern lock lost, decoder restarted
+	uint32_t directionChanges;
+} speedSensor_decoderStats_t;
+
+
 class speedSensor {
-	//TODO add count of revolutions/pulses if needed? (get(), reset() etc)
 public:
-	//constructor
-    speedSensor(speedSensor_config_t config);
+	//constructor (nvsHandle optional, used to persist odometer)
+    speedSensor(speedSensor_config_t config, nvs_handle_t * nvsHandle = NULL);
 	// initializes gpio pin, configures and starts interrupt
 	void init();
 	
@@ -33,23 +83,79 @@ public:
 	float getKmph(); //kilometers per hour
 	float getMps(); //meters per second
 	float getRpm();  //rotations per minute
-	uint32_t getTimeLastUpdate() {return timeLastUpdate;};
+	float getAccelKmphs(); //acceleration in km/h per second
+	//note: values are estimated by an alpha-beta observer, decay smoothly when edges stop (see getEstimate)
+	uint32_t getTimeLastUpdate(); //timestamp of last speed measurement (us)
+	speedSensor_state_t getState(); //speed, acceleration and update time from the same snapshot (use when combining them)
+	speedSensor_decoderStats_t getDecoderStats() {return decoderStats;};
+	bool isLocked() {return locked;}; //decoder is locked to the short/medium/long pattern
+
+	//distance (updated on every edge)
+	int64_t getPulseCount(); //signed pulse count since boot (reverse counts negative)
+	uint64_t getPulseCountAbs(); //pulses in any direction since boot
+	double getDistanceMeter(); //signed distance since boot
+	double getOdometerTotalMeter(); //total distance travelled (persistent)
+	double getOdometerTripMeter(); //distance travelled since last resetTrip() (persistent)
+	void resetTrip();
+	void saveOdometer(bool force = false); //write odometer to nvs if changed (at most once per minute unless forced)
+
+	//evaluate new edge (shared by all backends)
+	void processEdge(uint32_t timeElapsedUs, uint32_t timestampUs);
+	//evaluate all edges captured since last run (MCPWM_CAPTURE backend, run by capture task)
+	void drainCaptures();
 
 	//variables for handling the encoder (public because ISR needs access)
 	speedSensor_config_t config;
-	uint32_t pulseDurations[3] = {};
-	uint32_t pulse1, pulse2, pulse3;
-	uint32_t shortestPulse = 0;
-	uint32_t shortestPulsePrev = 0;
 	uint32_t lastEdgeTime = 0;
-	uint8_t pulseCounter = 0;
-	int debugCount = 0;
-	uint32_t debug_countIgnoredSequencesTooShort = 0;
-	double currentRpm = 0;
-	uint32_t timeLastUpdate = 0;
+
+	//captured edges (MCPWM_CAPTURE backend), written by capture ISR, read by capture task (single producer, single consumer)
+	uint32_t captureTicks[SPEED_CAPTURE_BUFFER_SIZE];
+	std::atomic<uint32_t> captureHead{0};
+	std::atomic<uint32_t> captureTail{0};
+	uint32_t captureTicksPrev = 0;
+	bool captureHasPrev = false;
+	uint32_t debug_countCaptureOverflow = 0;
 
 private:
+	//--- decoder state (written by edge path only) ---
+	uint32_t groupMdeg; //degreePerGroup in millidegree
+	uint32_t pulseDurations[3] = {};
+	uint8_t pulseCounter = 0; //index in pulseDurations of next (= oldest) pulse
+	uint8_t pulsesRecorded = 0; //pulses in window since standstill (max 3)
+	bool locked = false; //pattern position known (see processEdge)
+	uint32_t pendingPulse = 0; //fragment of current pulse (extra edge detected)
+	int directionPrev = 0;
+	speedSensor_decoderStats_t decoderStats = {};
+	uint32_t debug_countIgnoredSequencesTooShort = 0;
+	uint8_t pulsesUncounted = 0; //pulses pushed since last evaluation (direction not known yet)
+	speedSensor_snapshot_t state = {}; //working copy, published after each evaluation
+
+	//--- published snapshot (sequence lock: odd while writing) ---
+	volatile uint32_t snapshotSeq = 0;
+	speedSensor_snapshot_t snapshot = {};
+
+	void pushPulse(uint32_t duration);
+	void evaluateWindow(uint32_t currentTime);
+	void observeSpeed(int32_t measuredMdps, uint32_t nextPulseMdeg, uint32_t currentTime);
+	void publishSnapshot();
+	speedSensor_snapshot_t readSnapshot();
+	void getEstimate(const speedSensor_snapshot_t &snap, uint32_t timeNow, double * rpm, double * accel);
+
+	//--- odometer ---
+	double getMeterPerPulse();
+	void loadOdometer();
+	nvs_handle_t * nvsHandle = NULL;
+	uint64_t odoTotalBaseMm = 0; //odometer at boot (nvs)
+	uint64_t odoTripBaseMm = 0;
+	uint64_t odoTripStartPulses = 0; //pulseCountAbs at last trip reset
+	uint64_t odoPulsesLastWrite = 0;
+	uint32_t timestampOdoLastWrite = 0;
+
+	void initGpioIsr();
+	void initCapture();
 	static bool isrIsInitialized; // default false due to static
+	static speedSensor * captureSensors[3]; //sensors handled by capture task (one per capture channel)
+	static uint8_t captureSensorCount;
 };
 
 
@@ -0,0 +1,43 @@
+#include "telemetry.hpp"
+#include "types.hpp"
+
+//tag for logging
+static const char * TAG = "telemetry";
+
+
+//--- logRecord ---
+//output one record as compact csv line: name, time, state, dutyTarget, dutyNow, current, speed, flags, absEvents
+static void logRecord(const char * name, const motorTelemetry_t &r){
+    ESP_LOGD(TAG, "%s,%u,%s,%.2f,%.2f,%.2f,%.2f,%02x,%u", name, r.timestampUs, motorstateStr[r.state & 0x3],
+             r.dutyTarget / 100.0, r.dutyNow / 100.0, r.current / 100.0, r.speed / 100.0, r.flags, r.absEvents);
+}
+
+
+//--- drainBuffer ---
+//read all records currently in the buffer, warn when records were dropped since last run
+static void drainBuffer(const char * name, motorTelemetryBuffer_t * buffer, uint32_t * droppedPrev){
+    motorTelemetry_t record;
+    while (buffer->pop(&record))
+        logRecord(name, record);
+    uint32_t dropped = buffer->getDropped();
+    if (dropped != *droppedPrev){
+        ESP_LOGW(TAG, "[%s] buffer full - dropped %u records (total %u)", name, dropped - *droppedPrev, dropped);
+        *droppedPrev = dropped;
+    }
+}
+
+
+//============================
+//====== task_telemetry ======
+//============================
+void task_telemetry( void * telemetry_task_parameters ){
+    telemetry_task_parameters_t * params = (telemetry_task_parameters_t *)telemetry_task_parameters;
+    uint32_t droppedLeft = 0;
+    uint32_t droppedRight = 0;
+    ESP_LOGW(TAG, "Task-telemetry: draining motor telemetry every %dms...", params->msDrainInterval);
+    while(1){
+        drainBuffer("L", params->bufferLeft, &droppedLeft);
+        drainBuffer("R", params->bufferRight, &droppedRight);
+        vTaskDelay(params->msDrainInterval / portTICK_PERIOD_MS);
+    }
+}
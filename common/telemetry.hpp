@@ -0,0 +1,100 @@
+#pragma once
+
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+}
+
+#include <stdint.h>
+#include <atomic>
+
+
+//=======================================
+//====== struct/type  declarations ======
+//=======================================
+//flags stored in telemetry record
+#define TELEMETRY_FLAG_BRAKING (1 << 0)       //decel boost active (target in other direction)
+#define TELEMETRY_FLAG_TCS (1 << 1)           //traction control currently reducing duty
+#define TELEMETRY_FLAG_CURRENT_LIMIT (1 << 2) //current limit currently reducing duty
+#define TELEMETRY_FLAG_DEADTIME (1 << 3)      //waiting dead-time before direction change
+#define TELEMETRY_FLAG_TIMEOUT (1 << 4)       //no command received for a long time
+#define TELEMETRY_FLAG_ABS (1 << 5)           //anti-lock brake currently reducing brake strength
+
+//compact binary record of one control cycle of one motor (written by task_motorctl every cycle)
+//note: values are stored as scaled integers => no float formatting in control task, 16 bytes per record
+typedef struct motorTelemetry_t {
+    uint32_t timestampUs; //esp_timer (lower 32 bits, wraps after ~71min)
+    int16_t dutyTarget;   //0.01%
+    int16_t dutyNow;      //0.01%
+    int16_t current;      //0.01A
+    int16_t speed;        //0.01km/h
+    uint8_t state;        //motorstate_t
+    uint8_t flags;        //TELEMETRY_FLAG_x
+    uint16_t absEvents;   //count of anti-lock brake events so far (wraps)
+} motorTelemetry_t;
+
+
+
+//=====================================
+//====== telemetryBuffer class ========
+//=====================================
+//lock-free ring buffer for exactly one producer task (motorctl) and one consumer task (task_telemetry)
+//producer never blocks: when the buffer is full the record is dropped and counted
+//note: capacity has to be a power of 2
+template <uint32_t capacity>
+class telemetryBuffer {
+    static_assert((capacity & (capacity - 1)) == 0, "capacity has to be a power of 2");
+
+    public:
+        //--- producer ---
+        bool push(const motorTelemetry_t &record){
+            uint32_t head = headIndex.load(std::memory_order_relaxed);
+            if (head - tailIndex.load(std::memory_order_acquire) >= capacity){
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            records[head & (capacity - 1)] = record;
+            headIndex.store(head + 1, std::memory_order_release); //publish record
+            return true;
+        }
+
+        //--- consumer ---
+        bool pop(motorTelemetry_t * record){
+            uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+            if (tail == headIndex.load(std::memory_order_acquire)) return false; //empty
+            *record = records[tail & (capacity - 1)];
+            tailIndex.store(tail + 1, std::memory_order_release); //free slot
+            return true;
+        }
+
+        uint32_t getCount() {return headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire);};
+        uint32_t getDropped() {return dropped.load(std::memory_order_relaxed);};
+
+    private:
+        motorTelemetry_t records[capacity] = {};
+        std::atomic<uint32_t> headIndex{0}; //next slot written by producer (free running, only masked on access)
+        std::atomic<uint32_t> tailIndex{0}; //next slot read by consumer
+        std::atomic<uint32_t> dropped{0};
+};
+
+//buffer used by controlledMotor (256 records => 2.5s at 100Hz control rate)
+typedef telemetryBuffer<256> motorTelemetryBuffer_t;
+
+
+
+//====================================
+//========== telemetry task ==========
+//====================================
+// struct with variables passed to task from main
+typedef struct telemetry_task_parameters_t {
+    motorTelemetryBuffer_t * bufferLeft;
+    motorTelemetryBuffer_t * bufferRight;
+    uint32_t msDrainInterval; //time between draining the buffers
+} telemetry_task_parameters_t;
+
+// note: pointer to a 'telemetry_task_parameters_t' struct has to be provided as task-parameter
+// low priority task that drains the telemetry buffers of both motors and outputs the records (formatting happens here)
+// note: records are logged with DEBUG level with tag "telemetry" => enable with esp_log_level_set("telemetry", ESP_LOG_DEBUG)
+void task_telemetry( void * telemetry_task_parameters );
@@ -0,0 +1,47 @@
+#include "thermalmodel.hpp"
+#include <math.h>
+
+
+//============================
+//======= constructor ========
+//============================
+thermalModel::thermalModel(thermalModel_config_t config_f){
+    config = config_f;
+    heatLimit = config.currentContinuous * config.currentContinuous;
+}
+
+
+
+//============================
+//========== update ==========
+//============================
+//first order model: heat moves towards I² with time constant tau
+void thermalModel::update(float ampere, float dtSeconds){
+    if (config.tauSeconds <= 0) return;
+    float factor = 1 - expf(-dtSeconds / config.tauSeconds);
+    heat += (ampere * ampere - heat) * factor;
+}
+
+
+
+//=============================
+//========== getLoad ==========
+//=============================
+float thermalModel::getLoad() const{
+    if (heatLimit <= 0) return 0;
+    return heat / heatLimit;
+}
+
+
+
+//=====================================
+//========== getCurrentLimit ==========
+//=====================================
+//peak current while budget left, linear transition to continuous current between taperStartLoad and full load
+float thermalModel::getCurrentLimit() const{
+    float load = getLoad();
+    if (load <= config.taperStartLoad) return config.currentPeak;
+    if (load >= 1 || config.taperStartLoad >= 1) return config.currentContinuous;
+    float ratio = (load - config.taperStartLoad) / (1 - config.taperStartLoad);
+    return config.currentPeak - ratio * (config.currentPeak - config.currentContinuous);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//--- thermalModel_config_t ---
+typedef struct thermalModel_config_t {
+    float currentContinuous; //current that can flow permanently (steady-state heat = limit)
+    float currentPeak;       //max current allowed while thermal budget is left
+    float tauSeconds;        //thermal time constant (heating and cooling)
+    float taperStartLoad;    //load (0-1) above which the allowed current is reduced linearly towards continuous current
+} thermalModel_config_t;
+
+
+//==================================
+//======= thermalModel class =======
+//==================================
+//I²t model of heating of a component (motor winding, driver)
+//- heat integrates I² and decays exponentially with the thermal time constant (cooling)
+//- load = heat / heat at continuous current in steady state (1 = at thermal limit)
+//=> short bursts above the continuous current are possible (e.g. hill start) until the budget is used up,
+//   then the allowed current tapers smoothly to the continuous current
+class thermalModel {
+    public:
+        //--- functions ---
+        thermalModel(thermalModel_config_t config);
+
+        void update(float ampere, float dtSeconds); //integrate heating with measured current (run regularly)
+        float getCurrentLimit() const; //current currently allowed
+        float getLoad() const; //used thermal budget (0 = cold, 1 = at continuous limit)
+        void reset() {heat = 0;};
+
+    private:
+        //--- variables ---
+        thermalModel_config_t config;
+        float heat = 0; //A² (integrated I² filtered with time constant)
+        float heatLimit;  //heat at continuous current in steady state
+};
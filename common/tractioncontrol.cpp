@@ -0,0 +1,136 @@
+#include "tractioncontrol.hpp"
+#include <math.h>
+
+#define TCS_MAX_UPDATE_INTERVAL_US 500000 //older previous sample is not used for acceleration (e.g. after standstill)
+#define ABS_MAX_SPEED_DEFICIT_KMH 2 //wheel is locking when that much slower than the other wheel while braking
+
+
+//============================
+//======= constructor ========
+//============================
+tractionControl::tractionControl(tcs_config_t config_f){
+    config = config_f;
+}
+
+
+
+//=============================
+//========== observe ==========
+//=============================
+//use acceleration of the speed sensor observer (updated with every edge, timestamps of the edges)
+bool tractionControl::observe(float accelThis, uint32_t usTimeSpeedUpdate){
+    usLastInterval = usTimeSpeedUpdate - usTimePrev;
+    accelValid = hasPrev && usLastInterval > 0 && usLastInterval < TCS_MAX_UPDATE_INTERVAL_US;
+    accel = accelValid ? accelThis : 0;
+    usTimePrev = usTimeSpeedUpdate;
+    hasPrev = true;
+    return accelValid;
+}
+
+
+
+//============================
+//========== update ==========
+//============================
+//detect drive slip with last observation
+bool tractionControl::update(float speedThis, float speedOther, float dutyThis, float dutyOther, float currentThis,
+                             float speedAtFullDutyThis, float speedAtFullDutyOther){
+    //--- too slow => no reliable data ---
+    if (fabs(speedThis) < config.minSpeedKmh || !accelValid) {
+        slipping = false;
+        return false;
+    }
+
+    //direction the motor is driving (positive = forward)
+    float direction = (dutyThis != 0) ? copysignf(1, dutyThis) : copysignf(1, speedThis);
+    float secondsPassed = usLastInterval / 1000000.0;
+
+    //--- acceleration compared to current model ---
+    //with grip the whole vehicle has to be accelerated => acceleration is proportional to the current (torque)
+    float accelPredicted = config.accelPerAmpere * fabs(currentThis);
+    float accelExcess = accel * direction - accelPredicted;
+
+    //--- speed compared to other wheel and duty model ---
+    //speed difference explained by different duties (e.g. driving a curve), no division by possibly zero speeds
+    float speedDiffExpected = (dutyThis * speedAtFullDutyThis - dutyOther * speedAtFullDutyOther) / 100;
+    float speedExcess = ((speedThis - speedOther) - speedDiffExpected) * direction;
+
+    slipping = (accelExcess > config.maxAccelExcessKmhs) || (speedExcess > config.maxSpeedExcessKmh);
+
+    //--- limit duty to speed the wheel should have ---
+    if (slipping) {
+        //speed plausible with grip: speed before this update plus predicted acceleration, or matching the other wheel
+        float speedReference = fabs(speedThis) - (accelExcess > 0 ? accelExcess * secondsPassed : 0);
+        if (speedExcess > config.maxSpeedExcessKmh)
+            speedReference = fminf(speedReference, fabs(speedThis) - speedExcess);
+        float dutyReference = fmaxf(speedReference, 0) / speedAtFullDutyThis * 100;
+        dutyLimit = fminf(dutyLimit, fminf(dutyReference, fabs(dutyThis)));
+    }
+    return slipping;
+}
+
+
+
+//===============================
+//========== limitDuty ==========
+//===============================
+//clamp duty to current limit (keeps sign), gradually raise limit while not slipping
+float tractionControl::limitDuty(float duty, float dtSeconds){
+    if (!slipping && dutyLimit < 100) {
+        dutyLimit += config.restoreRate * dtSeconds;
+        if (dutyLimit > 100) dutyLimit = 100;
+    }
+    if (duty > dutyLimit) return dutyLimit;
+    if (duty < -dutyLimit) return -dutyLimit;
+    return duty;
+}
+
+
+
+//=================================
+//========== updateBrake ==========
+//=================================
+//detect locking wheel while braking with last observation
+bool tractionControl::updateBrake(float speedThis, float speedOther){
+    bool lockingPrev = locking;
+    //wheel (almost) stopped while other wheel is still moving => locked, no reliable acceleration needed
+    bool lockedCompared = fabs(speedOther) > config.minSpeedKmh && fabs(speedThis) < fabs(speedOther) - ABS_MAX_SPEED_DEFICIT_KMH;
+    //wheel decelerates faster than the chassis is able to
+    float decel = (accelValid && fabs(speedThis) >= config.minSpeedKmh) ? -accel * copysignf(1, speedThis) : 0;
+    locking = lockedCompared || decel > config.absMaxDecelKmhs;
+    //release brake once per event (modulation: reapplied gradually in getBrakeFactor)
+    if (locking) {
+        brakeFactor = fminf(brakeFactor, config.absReleaseFactor);
+        if (!lockingPrev) absEventCount++;
+    }
+    return locking;
+}
+
+
+
+//====================================
+//========== getBrakeFactor ==========
+//====================================
+//increase brake strength again while wheel is not locking
+float tractionControl::getBrakeFactor(float dtSeconds){
+    if (!locking && brakeFactor < 1) {
+        brakeFactor += config.absReapplyRate * dtSeconds;
+        if (brakeFactor > 1) brakeFactor = 1;
+    }
+    return brakeFactor;
+}
+
+
+
+//===========================
+//========== reset ==========
+//===========================
+void tractionControl::reset(){
+    hasPrev = false;
+    accelValid = false;
+    accel = 0;
+    dutyLimit = 100;
+    slipping = false;
+    brakeFactor = 1;
+    locking = false;
+}
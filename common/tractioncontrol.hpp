@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//--- tcs_config_t ---
+//parameters of the traction control and anti-lock brake model
+typedef struct tcs_config_t {
+    float accelPerAmpere;      //motor model: wheel acceleration (km/h per s) per ampere with grip (torque / vehicle mass)
+    float maxAccelExcessKmhs;  //slip when measured acceleration exceeds the predicted one by more than that (km/h per s)
+    float maxSpeedExcessKmh;   //slip when speed difference to other wheel exceeds the one expected from duty by more than that
+    float minSpeedKmh;         //traction control inactive below that speed (no reliable speed data, danger of deadlock)
+    float restoreRate;         //rate the duty limit is raised with once grip returns (% per second)
+    //anti-lock brake
+    float absMaxDecelKmhs;     //max deceleration the chassis can reach, wheel decelerating faster is locking (km/h per s)
+    float absReleaseFactor;    //brake strength is reduced to that factor (0-1) while wheel is locking
+    float absReapplyRate;      //rate brake strength is increased again after release (factor per second)
+} tcs_config_t;
+
+
+//=====================================
+//======= tractionControl class =======
+//=====================================
+//model based traction control and anti-lock brake for one wheel
+//- wheel acceleration is taken from the observer of the speed sensor (already filtered, no differentiation here)
+//- drive slip (TCS): wheel accelerates faster than commanded current predicts (wheel only has to accelerate
+//  itself), or spins faster relative to the other wheel than the duty ratio explains
+//  => duty is limited to the duty matching the speed the wheel should have (reacts within one update),
+//     once grip returns the limit is raised again gradually => torque is restored
+//- brake slip (ABS): wheel decelerates faster than the chassis can, or turns much slower than the other wheel
+//  => brake strength is released and reapplied gradually (modulation, shortest stopping distance)
+//note: works on signed values (negative = reverse), independent of control mode
+class tractionControl {
+    public:
+        //--- functions ---
+        tractionControl(tcs_config_t config);
+
+        //take acceleration estimated by speed sensor of this wheel (run once per speed sensor update)
+        //returns true when acceleration is valid (previous update recent enough)
+        bool observe(float accelThis, uint32_t usTimeSpeedUpdate);
+
+        //--- traction control ---
+        //evaluate drive slip using last observation, returns true when slip is detected
+        //speedAtFullDuty: motor model of each wheel (learned duty-speed map at current duty and battery voltage)
+        bool update(float speedThis, float speedOther, float dutyThis, float dutyOther, float currentThis,
+                    float speedAtFullDutyThis, float speedAtFullDutyOther);
+        //limit duty while slipping, raise limit when grip returned (run every control cycle)
+        float limitDuty(float duty, float dtSeconds);
+
+        //--- anti-lock brake ---
+        //evaluate brake slip using last observation (run once per speed sensor update while braking)
+        //returns true when wheel is locking
+        bool updateBrake(float speedThis, float speedOther);
+        //get factor (0-1) the brake strength has to be scaled with, reapply gradually (run every control cycle while braking)
+        float getBrakeFactor(float dtSeconds);
+        uint32_t getAbsEventCount() const {return absEventCount;};
+        void resetBrake() {brakeFactor = 1; locking = false;}; //start new brake event with full strength
+
+        void reset(); //release limits and forget history (e.g. when disabled or no speed data)
+        bool isSlipping() const {return slipping;};
+        bool isLimiting() const {return dutyLimit < 100 || brakeFactor < 1;};
+        bool isLocking() const {return locking;};
+        float getAccel() const {return accel;};
+        float getDutyLimit() const {return dutyLimit;};
+
+    private:
+        //--- variables ---
+        tcs_config_t config;
+        uint32_t usTimePrev = 0;
+        uint32_t usLastInterval = 0;
+        bool hasPrev = false;
+        bool accelValid = false;
+        float accel = 0; //km/h per second
+        float dutyLimit = 100;  //max absolute duty currently allowed
+        bool slipping = false;
+        //anti-lock brake
+        float brakeFactor = 1;
+        bool locking = false;
+        uint32_t absEventCount = 0; //count of detected locking events
+};
@@ -45,16 +45,52 @@ typedef struct motorctl_config_t {
     bool loggingEnabled; //enable/disable ALL log output (mostly better to debug only one instance)
     uint32_t msFadeAccel; //acceleration of the motor (ms it takes from 0% to 100%)
     uint32_t msFadeDecel; //deceleration of the motor (ms it takes from 100% to 0%)
+    uint32_t msJerkAccel; //time it takes to reach the full acceleration from constant duty (S-curve), 0 = linear ramp
+    uint32_t msJerkDecel; //time it takes to reach the full deceleration (S-curve), 0 = linear ramp
 	bool currentLimitEnabled;
     bool tractionControlSystemEnabled;
 	adc1_channel_t currentSensor_adc;
 	float currentSensor_ratedCurrent;
-    float currentMax;
+    float currentMax; //continuous current limit
+    float currentPeak; //current allowed for short time (thermal model, see thermalmodel.hpp)
+    float thermalTauMotorS; //thermal time constant of motor winding
+    float thermalTauDriverS; //thermal time constant of driver
+    float thermalTaperStartLoad; //thermal load (0-1) where allowed current starts to decrease from peak to continuous
     bool currentInverted;
     float currentSnapToZeroThreshold;
-	uint32_t deadTimeMs; //time motor stays in IDLE before direction change
+	uint32_t deadTimeMs; //time motor stays in IDLE before direction change (fallback when speed is unknown: no pulse since boot or sensor failed)
+	float deadTimeMaxSpeedKmh; //direction change allowed as soon as wheel is slower than that (0 and deadTimeMs 0 => dead time disabled)
     uint32_t brakePauseBeforeResume;
     uint32_t brakeDecel;
+    uint32_t msJerkBrake; //time it takes to reach the full brake deceleration, 0 = linear ramp
+    //speed control (motorControlMode_t::SPEED)
+    float speedControlMaxKmh; //target speed at 100% input duty
+    float speedControlMaxDuty; //max duty the speed controller may output
+    float speedControlKp; //default gains (overridden by values stored in nvs)
+    float speedControlKi;
+    float speedControlKd;
+    //current control (motorControlMode_t::CURRENT)
+    float currentControlKp; //duty (%) per ampere difference
+    float currentControlKi; //duty (%) per ampere difference and second
+    uint32_t currentControlPeriodMs; //min time between current controller updates
+    //cascaded speed-over-current control (motorControlMode_t::CASCADED)
+    float cascadeSpeedKp; //target current (A) per km/h speed difference
+    float cascadeSpeedKi; //target current (A) per km/h speed difference and second
+    uint32_t cascadeSpeedPeriodMs; //time between outer (speed) loop updates, inner loop runs with currentControlPeriodMs
+    //motor model
+    float speedAtFullDutyKmh; //speed at 100% duty (default of learned duty-speed map used as feedforward)
+    float dsMapVoltageMin; //battery voltage range of duty-speed map (binned)
+    float dsMapVoltageMax;
+    //traction control (see tractioncontrol.hpp)
+    float tcsAccelPerAmpere; //expected acceleration (km/h per s) per ampere when wheel has grip
+    float tcsMaxAccelExcessKmhs; //allowed acceleration above expected before limiting duty
+    float tcsMaxSpeedExcessKmh; //allowed speed difference to other wheel beyond the one expected from duty
+    float tcsRestoreRate; //rate duty limit is raised again after slip (% per second)
+    //anti-lock brake (see tractioncontrol.hpp)
+    bool absEnabled;
+    float absMaxDecelKmhs; //max deceleration the chassis can reach (km/h per s), wheel decelerating faster is locking
+    float absReleaseFactor; //brake strength is reduced to that factor (0-1) while locking
+    float absReapplyRate; //rate brake strength is increased again (factor per second)
 } motorctl_config_t;
 
 //enum fade type (acceleration, deceleration)